@@ -1,5 +1,6 @@
 import sys
 import json
+import struct
 import numpy as np
 import pyaudio
 import websocket
@@ -61,6 +62,7 @@ class WebSocketClient(QObject):
         super().__init__()
         self.ws = None
         self.connected = False
+        self.sequence = 0
         
     def connect_to_server(self, host, port):
         if self.connected:
@@ -104,8 +106,24 @@ class WebSocketClient(QObject):
             self.connection_status.emit(False, f"发送数据失败: {str(e)}")
             return False
     
+    def send_audio(self, samples, sample_rate=16000, channels=1):
+        """以二进制帧发送float32 PCM音频（头部格式见服务端 audio_protocol.h）"""
+        if not self.ws or not self.connected:
+            return False
+        
+        try:
+            pcm = np.asarray(samples, dtype='<f4').tobytes()
+            header = struct.pack('<4sBBHII', b'ATPC', 1, 1, channels, sample_rate, self.sequence)
+            self.sequence = (self.sequence + 1) & 0xFFFFFFFF
+            self.ws.send(header + pcm, opcode=websocket.ABNF.OPCODE_BINARY)
+            return True
+        except Exception as e:
+            self.connection_status.emit(False, f"发送数据失败: {str(e)}")
+            return False
+    
     def _on_open(self, ws):
         self.connected = True
+        self.sequence = 0
         self.connection_status.emit(True, "已成功连接到服务器！")
     
     def _on_message(self, ws, message):
@@ -399,6 +417,9 @@ class MainWindow(QMainWindow):
         self.disconnect_button.clicked.connect(self.on_disconnect)
         self.start_record_button.clicked.connect(self.on_start_recording)
         self.stop_record_button.clicked.connect(self.on_stop_recording)
+        
+        # 切换语言时更新服务端的会话配置
+        self.language_selector.currentIndexChanged.connect(self.send_session_config)
     
     def _load_audio_devices(self):
         input_devices, output_devices = self.audio_handler.get_devices()
@@ -435,12 +456,22 @@ class MainWindow(QMainWindow):
             self.connect_button.setEnabled(False)
             self.disconnect_button.setEnabled(True)
             self.start_record_button.setEnabled(True)
+            self.send_session_config()
         else:
             self.connect_button.setEnabled(True)
             self.disconnect_button.setEnabled(False)
             self.start_record_button.setEnabled(False)
             self.stop_record_button.setEnabled(False)
     
+    def send_session_config(self):
+        """发送会话识别配置（连接成功及切换语言时）"""
+        lang_map = {"中文": "zh", "英文": "en", "日语": "ja", "法语": "fr", "德语": "de"}
+        config = {
+            "type": "config",
+            "language": lang_map[self.language_selector.currentText()]
+        }
+        self.ws_client.send_data(config)
+    
     def on_start_recording(self):
         device_id = self.mic_selector.currentData()
         if device_id is not None:
@@ -467,19 +498,8 @@ class MainWindow(QMainWindow):
             self.connection_status.setText("没有可用的音频数据")
             return
         
-        # 获取当前选择的语言
-        lang_map = {"中文": "zh", "英文": "en", "日语": "ja", "法语": "fr", "德语": "de"}
-        selected_lang = lang_map[self.language_selector.currentText()]
-        
-        # 准备数据
-        data_to_send = {
-            "type": "audio_data",
-            "language": selected_lang,
-            "data": audio_data.tolist()
-        }
-        
-        # 发送数据
-        success = self.ws_client.send_data(data_to_send)
+        # 以二进制帧发送音频数据
+        success = self.ws_client.send_audio(audio_data)
         if success:
             self.connection_status.setText("已发送音频数据，等待识别结果...")
         else:
@@ -507,10 +527,6 @@ class MainWindow(QMainWindow):
     
     def auto_send_audio(self, audio_data):
         """自动发送音频数据的回调函数"""
-        # 获取当前选择的语言
-        lang_map = {"中文": "zh", "英文": "en", "日语": "ja", "法语": "fr", "德语": "de"}
-        selected_lang = lang_map[self.language_selector.currentText()]
-        
         # 计算应该发送的数据量（基于时间间隔）
         interval_ms = self.send_interval.value()
         sample_rate = 16000  # 采样率为16kHz
@@ -520,15 +536,8 @@ class MainWindow(QMainWindow):
         if len(audio_data) > samples_to_send:
             audio_data = audio_data[-samples_to_send:]
         
-        # 准备数据
-        data_to_send = {
-            "type": "audio_data",
-            "language": selected_lang,
-            "data": audio_data.tolist()
-        }
-        
-        # 发送数据
-        self.ws_client.send_data(data_to_send)
+        # 以二进制帧发送音频数据
+        self.ws_client.send_audio(audio_data, sample_rate)
 
 if __name__ == "__main__":
     app = QApplication(sys.argv)
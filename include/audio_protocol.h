@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// 二进制音频帧格式（所有字段均为小端）：
+//   偏移 0   4字节  魔数 "ATPC"
+//   偏移 4   1字节  版本号（当前为 1）
+//   偏移 5   1字节  采样格式（AudioSampleFormat）
+//   偏移 6   2字节  声道数
+//   偏移 8   4字节  采样率
+//   偏移 12  4字节  序号，每帧加一
+//   偏移 16  ...    PCM数据，多声道交错存放；Opus格式为一个完整的Opus包（不带Ogg封装）
+// PCM帧可以是任意声道数和 8kHz-192kHz 采样率，服务器混合为单声道并重采样到16kHz。
+// 不带头部的二进制帧按旧协议处理：16kHz 单声道 float32。
+// Opus帧的声道数和采样率字段为编码端参数，仅供参考，服务器统一解码为16kHz单声道。
+enum AudioSampleFormat : uint8_t {
+    AUDIO_FORMAT_FLOAT32 = 1,
+    AUDIO_FORMAT_INT16 = 2,
+    AUDIO_FORMAT_OPUS = 3
+};
+
+constexpr uint8_t AUDIO_PROTOCOL_VERSION = 1;
+constexpr size_t AUDIO_PACKET_HEADER_SIZE = 16;
+
+// 解析后的音频帧（data 指向原始负载，不复制）
+struct AudioPacket {
+    bool hasHeader;
+    AudioSampleFormat format;
+    uint16_t channels;
+    uint32_t sampleRate;
+    uint32_t sequence;
+    const uint8_t* data;
+    size_t size;
+};
+
+// 解析二进制音频帧，格式不合法时返回 false
+bool parseAudioPacket(const uint8_t* payload, size_t length, AudioPacket& packet);
+
+// 每个采样点的字节数，压缩格式返回 0
+size_t audioSampleSize(AudioSampleFormat format);
+
+// 是否为压缩编码格式（需要按流解码）
+bool isCompressedFormat(AudioSampleFormat format);
+
+// 把PCM数据转换为单声道float并追加到 out，返回追加的样本数
+size_t decodePcm(const AudioPacket& packet, std::vector<float>& out);
+
+// 把PCM数据的前 maxFrames 帧转换为单声道float写入 out，返回写入的样本数
+size_t decodePcm(const AudioPacket& packet, float* out, size_t maxFrames);
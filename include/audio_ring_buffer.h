@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 单生产者单消费者的音频环形缓冲区（无锁）
+// 容量向上取整为2的幂，存储区为容量的两倍，后半部分是前半部分的镜像：
+// 任何长度不超过容量的可读区域在内存中都是连续的，可以直接交给 whisper。
+// 读写位置是单调递增的样本计数，丢弃已读音频只需移动读位置。
+class AudioRingBuffer {
+public:
+    explicit AudioRingBuffer(size_t minCapacity);
+
+    AudioRingBuffer(const AudioRingBuffer&) = delete;
+    AudioRingBuffer& operator=(const AudioRingBuffer&) = delete;
+
+    // 生产者：写入样本，空间不足时只写入能容纳的部分，返回实际写入数量
+    size_t write(const float* samples, size_t count);
+
+    // 生产者：取得可直接写入的连续区域，最多 count 个样本，实际可写数量放在 available 中；
+    // 写好后调用 commit 提交，提交之前消费者看不到这些样本
+    float* writeRegion(size_t count, size_t& available);
+
+    // 生产者：提交 writeRegion 区域中写好的前 count 个样本（同步镜像区）
+    void commit(size_t count);
+
+    // 消费者：当前可读的样本数
+    size_t readable() const;
+
+    // 消费者：可读区域起点，[data(), data() + readable()) 连续
+    const float* data() const;
+
+    // 消费者：丢弃最早的 count 个样本
+    void consume(size_t count);
+
+    // 自创建以来读出（丢弃）的样本总数，即可读区域起点的绝对位置
+    uint64_t readPosition() const { return readPos_.load(std::memory_order_relaxed); }
+
+    // 自创建以来写入的样本总数
+    uint64_t writePosition() const { return writePos_.load(std::memory_order_acquire); }
+
+    size_t capacity() const { return capacity_; }
+
+private:
+    size_t capacity_;
+    size_t mask_;
+    std::vector<float> storage_;
+
+    alignas(64) std::atomic<uint64_t> writePos_;
+    alignas(64) std::atomic<uint64_t> readPos_;
+};
@@ -10,13 +10,28 @@
 #include <condition_variable>
 #include <memory>
 #include <map>
+#include <cstdint>
+#include <chrono>
+#include <nlohmann/json_fwd.hpp>
+#include "session_config.h"
+#include "outbound_queue.h"
+#include "permessage_deflate.h"
+#include "input_limits.h"
 
 class WebSocketServer;
+class OpusStreamDecoder;
+class PolyphaseResampler;
+struct AudioPacket;
 
-// 音频数据结构
-struct AudioData {
-    std::vector<float> buffer;
-    std::string clientId;
+// 会话的音频入口：连接建立时由连接回调创建，之后该连接的音频直接交给它，不再按客户端ID查找会话
+// 都在该连接所属的I/O线程中调用：16kHz单声道音频直接解码到 prepare 返回的区域
+// （通常就是会话的环形缓冲区），这是网络层和识别之间唯一的交接，不经过队列和处理线程
+struct AudioSink {
+    // 取得可直接写入的连续区域，最多 count 个样本，实际可写数量放在 available 中
+    std::function<float*(size_t count, size_t& available)> prepare;
+    // 提交区域中写好的前 written 个样本，dropped 为空间不足放不下的样本数
+    std::function<void(size_t written, size_t dropped)> commit;
+    std::function<void()> close;                        // 客户端已断开，之前的音频都已写入，之后不会再调用
 };
 
 class AudioServer {
@@ -27,8 +42,8 @@ public:
     // 初始化websocket服务器
     bool initialize(const std::string& host = "localhost", int port = 3000);
     
-    // 开始监听音频数据
-    bool start(std::function<void(const std::vector<float>&, const std::string&)> callback);
+    // 开始处理音频数据（连接回调应在此之前设置）
+    bool start();
     
     // 停止监听
     void stop();
@@ -38,21 +53,48 @@ public:
     
     // 发送文本识别结果
     void sendTextResult(const std::string& text, bool isComplete, const std::string& targetClientId = "");
+    
+    // 设置发送队列限制和慢客户端策略
+    void setOutboundQueueOptions(const OutboundQueueOptions& options);
+    
+    // 设置permessage-deflate压缩配置
+    void setCompressionOptions(const DeflateOptions& options);
+    
+    // 设置输入限制：单帧和单条消息的长度、所有连接共享的内存预算
+    void setInputLimits(const InputLimits& limits);
+    
+    // 输入限制统计（网络层拒绝的帧和消息，以及会话缓冲区已满丢弃的音频）
+    InputLimitStats inputLimitStats() const;
+    
+    // 分片发送的二进制音频是否逐片处理：开启后每个分片到达即解码写入会话，不等整条消息重组完成
+    void setStreamFragments(bool enabled);
+    
+    // 设置连接回调，在网络线程中调用：为新连接的客户端创建会话，返回该会话的音频入口
+    void setConnectCallback(std::function<AudioSink(const std::string&)> callback);
+    
+    // 设置会话配置回调，在网络线程中调用
+    // 需要加载模型时回调应立即返回，模型就绪后再调用 done（可以在任意线程），在此之前会话继续使用旧配置；
+    // done(true) 时回复 config_ack，done(false) 表示配置不被接受
+    void setConfigCallback(std::function<void(const SessionConfig&, const std::string&, std::function<void(bool)>)> callback);
 
 private:
     // WebSocket服务器
     std::shared_ptr<WebSocketServer> server_;
     
     // 回调函数
-    std::function<void(const std::vector<float>&, const std::string&)> audioCallback_;
+    std::function<AudioSink(const std::string&)> connectCallback_;
+    std::function<void(const SessionConfig&, const std::string&, std::function<void(bool)>)> configCallback_;
+    std::mutex configCallbackMutex_;  // 连接和配置回调在网络线程中调用，设置时需要加锁
     
-    // 线程安全队列，用于存储接收到的音频数据
-    std::queue<AudioData> audioQueue_;
-    std::mutex queueMutex_;
-    std::condition_variable queueCondition_;
-    
-    // 处理线程
-    std::thread processingThread_;
+    // 输入限制（由 limitsMutex_ 保护，I/O线程只读取原子的 maxMessageBytes_），
+    // 未处理完的分片音频和网络层的输入缓冲共用同一个内存预算
+    InputLimits inputLimits_;
+    std::mutex limitsMutex_;
+    std::atomic<size_t> maxMessageBytes_;
+    std::shared_ptr<MemoryBudget> memoryBudget_;
+    std::atomic<uint64_t> droppedAudioPackets_{0};
+    std::atomic<uint64_t> audioBudgetRejects_{0};
+    std::atomic<uint64_t> loggedAudioRejects_{0};
     
     // 运行标志
     std::atomic<bool> running_;
@@ -64,9 +106,86 @@ private:
     std::string host_;
     int port_;
     
-    // 处理音频数据的线程函数
-    void processAudioData();
+    // 逐片处理中的分片音频消息
+    struct FragmentState {
+        std::vector<uint8_t> pending;   // 头部加尚未处理的字节（不足一个采样帧的尾部，或等待完整的Opus包）
+        size_t headerSize = 0;          // pending 开头的头部长度：0 为旧协议，否则为 AUDIO_PACKET_HEADER_SIZE
+        bool headerParsed = false;
+        bool whole = false;             // 压缩格式，收齐最后一片再解码
+        bool delivered = false;         // 已处理过该消息的音频，序号只在第一段检查
+        bool discard = false;           // 头部不合法，忽略该消息剩下的分片
+        size_t reserved = 0;            // 为 pending 从内存预算中预留的字节数
+    };
+    
+    // 每个连接的音频流状态：连接建立时创建，作为连接的上下文由网络层保存，各个回调直接取用
+    // 只在该连接所属的I/O线程中访问，不需要加锁
+    struct ClientStream {
+        const std::string clientId;
+        AudioSink sink;                                   // 会话的音频入口
+        bool started = false;
+        uint32_t nextSequence = 0;
+        std::string speaker = "unknown";
+        std::shared_ptr<OpusStreamDecoder> opusDecoder;   // 收到第一个Opus帧时创建
+        std::shared_ptr<PolyphaseResampler> resampler;    // 非16kHz的PCM流使用，采样率变化时重建
+        FragmentState fragment;
+        std::vector<float> decoded;                       // Opus、JSON和需要重采样的PCM的解码缓冲区，跨帧复用
+        std::vector<float> resampled;                     // 重采样输出，与 decoded 交换使用
+
+        explicit ClientStream(const std::string& id) : clientId(id) {}
+    };
+    
+    // 压缩音频解码统计
+    std::atomic<uint64_t> opusPackets_{0};
+    std::atomic<uint64_t> opusBytes_{0};
+    std::atomic<uint64_t> opusSamples_{0};
+    std::atomic<uint64_t> opusConcealedSamples_{0};
+    std::atomic<uint64_t> opusErrors_{0};
+    std::atomic<uint64_t> opusDecodeNanos_{0};
+    std::atomic<uint64_t> loggedOpusPackets_{0};
+    std::atomic<int64_t> lastStatsLog_;   // 上次输出统计的时间（steady_clock 纳秒），各个I/O线程到期时抢占输出
+    
+    // 新连接：创建流状态和会话
+    std::shared_ptr<void> handleConnect(const std::string& clientId);
     
     // 接收数据处理函数
-    void handleIncomingMessage(const std::string& message, const std::string& clientId);
+    void handleIncomingMessage(const std::string& message, ClientStream& stream);
+    
+    // 处理会话配置消息
+    void handleConfigMessage(const nlohmann::json& message, const std::string& clientId);
+    
+    // 客户端断开：归还分片预留，关闭会话
+    void handleDisconnect(ClientStream& stream);
+    
+    // 接收二进制音频帧
+    void handleBinaryMessage(const uint8_t* data, size_t length, ClientStream& stream);
+    
+    // 接收分片二进制音频消息的一片
+    void handleBinaryFragment(const uint8_t* data, size_t length, bool first, bool last, ClientStream& stream);
+    
+    // 归还分片状态超出 keep 字节的预留
+    void releaseFragmentReservation(FragmentState& state, size_t keep);
+    
+    // 解码一个音频帧（或分片消息中完整的一段）写入会话，做声纹识别
+    void handleAudioPacket(const AudioPacket& packet, ClientStream& stream);
+    
+    // 解码一个Opus帧，序号不连续时先补偿丢失的包
+    bool decodeOpusPacket(const AudioPacket& packet, ClientStream& stream, std::vector<float>& out);
+    
+    // 将单声道PCM从流头声明的采样率重采样为16kHz
+    bool resamplePcm(const AudioPacket& packet, ClientStream& stream, std::vector<float>& audio);
+    
+    // 定期输出压缩音频的解码统计
+    void logDecodeStats();
+    
+    // 有音频因超出限制被丢弃时输出统计
+    void logInputLimitStats();
+    
+    // 把已解码的音频复制到会话的写入区域
+    void writeAudio(ClientStream& stream, const float* samples, size_t count);
+    
+    // 提交写入的音频，空间不足丢弃的计入统计
+    void commitAudio(ClientStream& stream, size_t written, size_t dropped);
+    
+    // 发送错误信息给客户端
+    void sendError(const std::string& message, const std::string& clientId);
 }; 
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include "model_registry.h"
+
+// 解码任务：在工作线程上执行，参数为任务指定的模型和从该模型借出的解码状态
+// （无法创建解码状态时 state 为空，任务应跳过解码）
+using DecodeJob = std::function<void(whisper_context*, whisper_state*)>;
+
+// 解码任务的优先级：确认句子的解码总是先于实时结果的解码
+enum class DecodePriority {
+    Final,      // 产生最终结果（T:）的解码：语音结束后的解码、两遍解码的整句重新解码
+    Partial     // 流式窗口的增量解码，只更新实时结果（L:）
+};
+
+// 解码工作池
+// 工作线程不绑定模型：每个任务携带要使用的模型，执行时从模型的状态池借用一个
+// whisper_state，多个客户端（以及不同模型）的解码可以并行执行。
+// 排队的任务先按优先级、再按截止时间（越早越先）、最后按提交顺序执行，
+// 过载时实时结果最久没有刷新的会话先解码，而不是按提交顺序。
+class DecoderPool {
+public:
+    DecoderPool();
+    ~DecoderPool();
+
+    // 启动工作线程
+    bool start(int workers, int threadsPerWorker);
+
+    // 停止所有工作线程，未执行的任务被丢弃
+    void stop();
+
+    // 提交解码任务，任务执行期间持有模型的引用
+    // 同一优先级的任务按 deadline 先后执行，未指定时按提交顺序
+    bool submit(std::shared_ptr<WhisperModel> model, DecodeJob job,
+                DecodePriority priority = DecodePriority::Final,
+                std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point());
+
+    // 工作线程数
+    int workerCount() const { return (int)workers_.size(); }
+
+    // 每个工作线程内 whisper 使用的计算线程数
+    int threadsPerWorker() const { return threadsPerWorker_; }
+
+private:
+    struct Task {
+        std::shared_ptr<WhisperModel> model;
+        DecodeJob job;
+        DecodePriority priority;
+        std::chrono::steady_clock::time_point deadline;
+        uint64_t sequence;
+    };
+
+    // 堆的比较函数：a 应在 b 之后执行时返回 true，堆顶为下一个执行的任务
+    struct RunsAfter {
+        bool operator()(const Task& a, const Task& b) const;
+    };
+
+    void workerLoop();
+
+    int threadsPerWorker_;
+    std::vector<std::thread> workers_;
+
+    std::vector<Task> jobs_;    // 按 RunsAfter 组织的堆
+    uint64_t nextSequence_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::atomic<bool> running_;
+};
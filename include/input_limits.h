@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// 客户端输入的资源限制，全部在分配内存之前检查
+// 单帧和单条消息超出上限时断开连接；会话积压的音频超出上限时丢弃新到的音频。
+struct InputLimits {
+    size_t maxFrameBytes = 1024 * 1024;          // 单个帧负载的最大字节数
+    size_t maxMessageBytes = 16 * 1024 * 1024;   // 分片重组后、解压后的消息最大字节数（逐片处理的音频消息除外）
+    double maxBufferedSeconds = 10.0;            // 每个会话在识别窗口之外最多积压的音频，决定会话环形缓冲区的大小
+    size_t memoryBudget = 256 * 1024 * 1024;     // 所有连接的输入缓冲（未收完的帧、重组中的消息、未处理完的分片音频）总上限，0 表示不限制
+};
+
+// 输入限制统计
+struct InputLimitStats {
+    uint64_t oversizedFrames = 0;       // 超过单帧上限被拒绝的帧
+    uint64_t oversizedMessages = 0;     // 重组或解压后超过上限被拒绝的消息
+    uint64_t budgetRejects = 0;         // 因超出全局内存预算被拒绝的帧、消息和音频
+    uint64_t droppedAudioPackets = 0;   // 会话积压超过上限被丢弃的音频帧
+    size_t budgetUsed = 0;              // 当前预留的字节数
+};
+
+// 所有连接共享的输入内存预算：分配之前预留，释放之后归还
+class MemoryBudget {
+public:
+    explicit MemoryBudget(size_t limit = 0) : limit_(limit), used_(0) {}
+
+    void setLimit(size_t limit) { limit_ = limit; }
+
+    // 预留 bytes 字节，超出预算时不预留并返回 false
+    bool tryReserve(size_t bytes) {
+        const size_t limit = limit_;
+        size_t used = used_.load();
+        do {
+            if (limit != 0 && (bytes > limit || used > limit - bytes)) {
+                return false;
+            }
+        } while (!used_.compare_exchange_weak(used, used + bytes));
+        return true;
+    }
+
+    void release(size_t bytes) { used_ -= bytes; }
+
+    size_t used() const { return used_; }
+
+private:
+    std::atomic<size_t> limit_;
+    std::atomic<size_t> used_;
+};
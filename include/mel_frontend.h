@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 增量 log-mel 前端
+// 计算方法与 whisper 相同：400点FFT、10毫秒帧移、Hann窗、Slaney mel滤波器组、log10。
+// 流式识别相邻两次解码的窗口大部分重叠，已经算过的帧按绝对位置缓存在环形存储中，
+// 每次解码只对新到达的音频做FFT，再按 whisper 的方式对整个窗口归一化，
+// 结果交给 whisper_set_mel_with_state，whisper 不再重新计算整个窗口的频谱。
+// 只由识别器的消费者（解码线程）使用。
+class MelFrontend {
+public:
+    static constexpr int SAMPLE_RATE = 16000;
+    static constexpr int N_FFT = 400;
+    static constexpr int HOP_LENGTH = 160;
+
+    // maxSamples 为解码窗口的最大样本数，决定缓存的帧数
+    explicit MelFrontend(size_t maxSamples);
+
+    // 生成绝对位置 start 起 count 个样本的 log-mel，布局与 whisper 相同（n_mel 行 × nLen 列），
+    // 音频之后补 paddingFrames 帧静音，供编码器窗口读取。
+    // 返回音频本身的帧数（即 whisper 的 n_len_org），nLen 为包含静音的总帧数
+    int compute(const float* samples, uint64_t start, size_t count, int nMel, int paddingFrames,
+                std::vector<float>& mel, int& nLen);
+
+    // 清空缓存的帧
+    void reset();
+
+private:
+    // 按 mel 通道数生成滤波器组（80 或 128，取决于模型）
+    void buildFilters(int nMel);
+
+    // 计算帧 index 的 log10 mel 能量；窗口超出音频时起点镜像填充、终点补零
+    void computeFrame(const float* samples, uint64_t start, size_t count, uint64_t index, float* out);
+
+    // 实数输入的混合基FFT：偶数长度按奇偶拆分递归，奇数长度直接DFT（400 = 16 × 25）
+    // in 需要 2n 个元素的空间，out 需要 8n 个元素的空间
+    void fft(float* in, int n, float* out) const;
+
+    float* frameAt(uint64_t index) { return frames_.data() + (index % capacity_) * nMel_; }
+
+    int nMel_;
+    std::vector<float> filters_;       // 每个通道只存非零权重，连续存放
+    std::vector<int> filterBegin_;     // 每个通道第一个非零频点
+    std::vector<int> filterLength_;    // 每个通道非零频点数
+    std::vector<size_t> filterOffset_; // 每个通道权重在 filters_ 中的起点
+
+    std::vector<float> hann_;
+    std::vector<float> cos_;
+    std::vector<float> sin_;
+    std::vector<float> frameBuffer_;
+    std::vector<float> fftIn_;
+    std::vector<float> fftOut_;
+    std::vector<float> tail_;          // 跨越音频末尾的帧，音频继续到达后会变化，不缓存
+
+    size_t capacity_;                  // 缓存的帧数
+    std::vector<float> frames_;        // 未归一化的 log10 能量，每帧 nMel_ 个
+    uint64_t origin_;                  // 第0帧中心的绝对样本位置
+    uint64_t endFrame_;                // 缓存帧的结束序号
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <cstddef>
+#include <cstdint>
+
+struct whisper_context;
+struct whisper_state;
+
+// 已加载的模型：权重（whisper_context）和按需创建的解码状态池
+// 同一时刻每个解码状态只被一个工作线程使用，状态数量不超过并发解码数。
+class WhisperModel {
+public:
+    WhisperModel(const std::string& name, whisper_context* ctx, size_t memoryBytes);
+    ~WhisperModel();
+
+    WhisperModel(const WhisperModel&) = delete;
+    WhisperModel& operator=(const WhisperModel&) = delete;
+
+    const std::string& name() const { return name_; }
+    whisper_context* context() const { return ctx_; }
+    size_t memoryBytes() const { return memoryBytes_; }
+
+    // 取一个空闲的解码状态，没有则新建；失败返回 nullptr
+    whisper_state* acquireState();
+
+    // 归还解码状态
+    void releaseState(whisper_state* state);
+
+private:
+    std::string name_;
+    whisper_context* ctx_;
+    size_t memoryBytes_;
+
+    std::mutex mutex_;
+    std::vector<whisper_state*> freeStates_;
+    std::vector<whisper_state*> allStates_;
+};
+
+// 模型注册表
+// 按名称（tiny/base/small/large-v3-turbo 等）登记多个模型文件，首次使用时加载。
+// 引用计数由 shared_ptr 实现：会话和解码任务持有模型期间不会被卸载；
+// 加载新模型超出内存预算时，按最近最少使用的顺序卸载空闲模型。
+// 每个模型占用的预算为权重文件大小加上 statesPerModel 个解码状态（KV缓存和计算缓冲）的估计值。
+class ModelRegistry {
+public:
+    // memoryBudget 为已加载模型的内存上限（字节），0 表示不限制；
+    // statesPerModel 为每个模型最多同时使用的解码状态数（即解码工作线程数）
+    ModelRegistry(bool useGpu, size_t memoryBudget = 0, int statesPerModel = 1);
+    ~ModelRegistry();
+
+    // 登记模型文件
+    void registerModel(const std::string& name, const std::string& path);
+
+    // 登记目录下的全部 ggml-*.bin 模型文件，返回登记的数量
+    int registerDirectory(const std::string& directory);
+
+    // 是否登记了该模型
+    bool hasModel(const std::string& name) const;
+
+    // 已登记的模型名称
+    std::vector<std::string> modelNames() const;
+
+    // 模型是否已经加载（已加载时 acquire 不会阻塞）
+    bool isLoaded(const std::string& name) const;
+
+    // 获取模型，未加载时在调用线程加载，可能耗时数秒；无法加载或超出内存预算时返回 nullptr。
+    // 多个线程同时获取同一个未加载的模型时只加载一次，其余线程等待这次加载的结果
+    std::shared_ptr<WhisperModel> acquire(const std::string& name);
+
+    // 设置默认模型（加载并常驻，不会被卸载）
+    bool setDefaultModel(const std::string& name);
+
+    // 默认模型
+    std::shared_ptr<WhisperModel> defaultModel() const;
+
+    // 从文件名推出模型名称：models/ggml-small.bin -> small
+    static std::string modelNameFromPath(const std::string& path);
+
+    // 估计一个解码状态占用的内存（字节），按模型超参数推算，与 whisper_init_state 的分配大致相当
+    static size_t estimateStateBytes(whisper_context* ctx);
+
+private:
+    struct Entry {
+        std::string path;
+        size_t fileSize = 0;
+        std::shared_ptr<WhisperModel> model;   // 未加载时为空
+        std::shared_future<std::shared_ptr<WhisperModel>> loading;  // 正在加载时有效
+        uint64_t lastUsed = 0;
+    };
+
+    // 卸载空闲模型直到能放下 required 字节，调用时需持有 mutex_
+    bool makeRoom(size_t required);
+
+    bool useGpu_;
+    size_t memoryBudget_;
+    size_t statesPerModel_;
+    size_t loadedBytes_;
+    uint64_t useCounter_;
+
+    std::map<std::string, Entry> entries_;
+    std::shared_ptr<WhisperModel> defaultModel_;
+    mutable std::mutex mutex_;
+};
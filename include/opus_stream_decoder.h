@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+struct OpusDecoder;
+
+// 单个客户端音频流的Opus解码器
+// 直接按16kHz单声道输出，与识别管线的采样率一致，不需要再重采样；
+// 立体声流由解码器混为单声道。解码器有跨包状态，每个流独占一个实例。
+class OpusStreamDecoder {
+public:
+    static constexpr int OUTPUT_SAMPLE_RATE = 16000;
+
+    OpusStreamDecoder();
+    ~OpusStreamDecoder();
+
+    OpusStreamDecoder(const OpusStreamDecoder&) = delete;
+    OpusStreamDecoder& operator=(const OpusStreamDecoder&) = delete;
+
+    // 是否编译了Opus支持
+    static bool supported();
+
+    // 解码一个Opus包，样本追加到 out，返回追加的样本数，出错返回 -1
+    int decode(const uint8_t* packet, size_t size, std::vector<float>& out);
+
+    // 丢包补偿：按上一个包的时长生成 lostPackets 个包的补偿音频，返回追加的样本数
+    int conceal(size_t lostPackets, std::vector<float>& out);
+
+private:
+    OpusDecoder* decoder_;
+    int lastPacketSamples_;    // 上一个包的样本数，丢包补偿按此时长生成
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// 发送给客户端的消息类别
+enum class MessageClass {
+    Reliable,   // 必须按顺序送达：最终结果（T:）、配置应答、错误等
+    Partial     // 实时结果（L:），只有最新一条有意义，客户端跟不上时可以丢弃
+};
+
+// 客户端接收跟不上、发送队列超出上限时的处理策略
+enum class SlowClientPolicy {
+    DropStale,    // 超出上限时丢弃队列中尚未发送的实时结果
+    Coalesce,     // 队列中始终只保留最新一条未发送的实时结果，超出上限时同 DropStale
+    Disconnect    // 超出上限时断开连接
+};
+
+// 每个连接发送队列的限制
+// 最终结果不会被丢弃：丢弃全部实时结果后仍超出上限时，任何策略下都会断开连接。
+struct OutboundQueueOptions {
+    size_t maxFrames = 256;
+    size_t maxBytes = 1024 * 1024;
+    SlowClientPolicy policy = SlowClientPolicy::Coalesce;
+};
+
+// 发送队列统计
+struct OutboundQueueStats {
+    size_t connections = 0;
+    size_t queuedFrames = 0;          // 所有连接当前排队的帧数
+    size_t queuedBytes = 0;           // 所有连接当前排队的字节数
+    size_t maxQueuedBytes = 0;        // 积压最多的连接排队的字节数
+    uint64_t droppedPartials = 0;     // 累计丢弃的实时结果
+    uint64_t coalescedPartials = 0;   // 累计被更新结果替换的实时结果
+    uint64_t slowDisconnects = 0;     // 累计因积压断开的连接
+};
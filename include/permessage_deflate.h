@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <memory>
+
+// permessage-deflate（RFC 7692）服务器端配置
+struct DeflateOptions {
+    bool enabled = true;
+    int serverMaxWindowBits = 15;           // 服务器压缩窗口（9-15），越小每个连接占用的内存越少
+    int clientMaxWindowBits = 15;           // 要求客户端使用的压缩窗口，客户端声明支持时才生效
+    bool serverNoContextTakeover = false;   // 每条消息独立压缩，不跨消息保留字典
+    int compressionLevel = 6;
+    int memLevel = 8;
+    size_t minCompressSize = 128;           // 短于此长度的消息不压缩，直接发送
+};
+
+// 与一个客户端协商出的参数
+struct DeflateParams {
+    int serverMaxWindowBits = 15;
+    int clientMaxWindowBits = 15;
+    bool serverNoContextTakeover = false;
+    bool clientNoContextTakeover = false;
+};
+
+// 是否编译了压缩支持（需要zlib）
+bool deflateSupported();
+
+// 按客户端 Sec-WebSocket-Extensions 请求头中的提议协商，
+// 接受时填写协商参数和应答头的值，不支持或全部提议都无法满足时返回false
+bool negotiatePerMessageDeflate(const std::string& offers, const DeflateOptions& options,
+                                DeflateParams& params, std::string& response);
+
+// 一个连接的压缩和解压上下文
+// 压缩只在发送线程调用，解压只在接收线程调用，两者互不影响。
+class PerMessageDeflate {
+public:
+    PerMessageDeflate(const DeflateParams& params, const DeflateOptions& options);
+    ~PerMessageDeflate();
+
+    PerMessageDeflate(const PerMessageDeflate&) = delete;
+    PerMessageDeflate& operator=(const PerMessageDeflate&) = delete;
+
+    // zlib流是否初始化成功
+    bool valid() const;
+
+    // 消息是否值得压缩
+    bool shouldCompress(size_t length) const { return length >= minCompressSize_; }
+
+    // 压缩一条消息的负载，结果追加到 out
+    bool compress(const uint8_t* data, size_t length, std::vector<uint8_t>& out);
+
+    // 解压一条消息的负载到 out，结果超过 maxSize 时失败
+    bool decompress(const uint8_t* data, size_t length, std::vector<uint8_t>& out, size_t maxSize);
+
+private:
+    struct Streams;
+
+    std::unique_ptr<Streams> streams_;
+    DeflateParams params_;
+    size_t minCompressSize_;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// 多相FIR重采样器
+// 输入输出采样率之比化简为 L/M（如 48k->16k 为 1/3，44.1k->16k 为 160/441），
+// 用Kaiser窗sinc原型滤波器拆成 L 组相位系数，每个输出样本只计算一组系数的点积。
+// 相同比例的滤波器组全局共享，只计算一次；点积使用SSE/NEON向量指令。
+// 按块流式处理，块之间保留滤波器长度的历史样本，输出与一次性处理整段音频一致。
+class PolyphaseResampler {
+public:
+    struct FilterBank;
+
+    PolyphaseResampler(int inputRate, int outputRate = 16000);
+
+    // 是否支持该输入采样率（8kHz-192kHz，化简后的比例不能太复杂）
+    static bool supported(int inputRate, int outputRate = 16000);
+
+    int inputRate() const { return inputRate_; }
+    int outputRate() const { return outputRate_; }
+
+    // 转换一段单声道输入，输出追加到 out，返回追加的样本数
+    size_t process(const float* input, size_t count, std::vector<float>& out);
+
+    // 清空历史，开始新的音频流
+    void reset();
+
+private:
+    int inputRate_;
+    int outputRate_;
+    std::shared_ptr<const FilterBank> bank_;
+    std::vector<float> buffer_;    // 上一块末尾的历史样本 + 当前块
+    uint64_t position_;            // 下一个输出样本在上采样时间轴上相对当前块起点的位置
+};
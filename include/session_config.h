@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+
+// 会话识别配置，客户端连接后通过 config 消息设置，未设置的字段使用默认值
+struct SessionConfig {
+    std::string language = "zh";   // 识别语言，"auto" 表示自动检测
+    std::string model;             // 模型档位，空表示服务器默认模型
+    std::string draftModel;        // 实时结果使用的草稿模型，空表示服务器默认（未设置则不做二次解码）
+    int beamSize = 1;              // 1 为贪心解码，大于1使用束搜索
+    int audioCtx = 0;              // 编码器音频上下文长度，0 表示模型默认值
+    int maxTokens = 128;           // 每段最多输出的token数
+    bool translate = false;        // 是否翻译为英文
+    int promptTokens = 64;         // 解码时带入的已确认文本token数，0 表示每次解码不带上下文
+    std::string encoderMode;       // 编码器模式："full" 编码完整30秒窗口，"chunked" 只编码当前窗口（按块取整）；空表示服务器默认
+};
+
+// 配置取值范围
+constexpr int MAX_BEAM_SIZE = 8;
+constexpr int MAX_AUDIO_CTX = 1500;
+constexpr int MAX_SEGMENT_TOKENS = 224;
+constexpr int MAX_PROMPT_TOKENS = 224;
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "audio_ring_buffer.h"
+#include "mel_frontend.h"
+#include "token_timestamps.h"
+
+struct whisper_context;
+struct whisper_state;
+struct whisper_full_params;
+
+// 一次增量识别的输出
+struct RecognitionUpdate {
+    std::string partial;                 // 当前句子的实时结果（L:），已确认部分 + 未稳定尾部
+    std::vector<std::string> completed;  // 本次确认完成的句子（T:）
+    std::vector<std::vector<float>> completedAudio;  // 与 completed 一一对应的音频（开启 setCaptureSentenceAudio 时）
+};
+
+// 流式识别器（LocalAgreement）
+// 维护一个滑动音频窗口，窗口内的识别结果分为已确认区和未确认区：
+// 相邻两次解码结果的最长公共前缀被确认，确认的句子输出后窗口前移，
+// 因此每次解码只覆盖尚未稳定的尾部音频，单次解码开销有上限。
+// 窗口存放在单生产者单消费者环形缓冲区中：appendAudio 可以由接收线程调用，
+// 其余方法由识别线程调用，两者之间不需要加锁。
+// 窗口的 log-mel 由 MelFrontend 增量计算，重叠部分不会在每次解码时重新计算。
+// 音频已移出窗口的已确认文本保留最近的若干token，作为下一次解码的提示（prompt_tokens）。
+class StreamingRecognizer {
+public:
+    explicit StreamingRecognizer(int sampleRate = 16000, size_t bufferSamples = 0);
+
+    // 追加新音频（生产者），缓冲区满时返回实际写入的样本数
+    size_t appendAudio(const float* samples, size_t count);
+
+    // 直接在窗口缓冲区中写入新音频（生产者），见 AudioRingBuffer::writeRegion 和 commit
+    float* prepareAudio(size_t count, size_t& available) { return window_.writeRegion(count, available); }
+    void commitAudio(size_t count) { window_.commit(count); }
+
+    // 累计收到的样本数
+    uint64_t receivedSamples() const { return window_.writePosition(); }
+
+    // 是否有足够的新音频需要解码
+    bool readyToDecode() const;
+
+    // 是否还有尚未解码的音频（语音停顿时补一次解码）
+    bool hasUndecodedAudio() const;
+
+    // 使用给定的解码状态对当前窗口解码一次并更新确认状态
+    bool decode(whisper_context* ctx, whisper_state* state, const whisper_full_params& params, RecognitionUpdate& update);
+
+    // 语音结束：返回窗口中剩余的全部文本并重置状态，
+    // endPosition 为语音结束的绝对样本位置，之后的音频属于下一句，保留在窗口中；
+    // audio 不为空时输出这段文本对应的音频
+    std::string flush(uint64_t endPosition = UINT64_MAX, std::vector<float>* audio = nullptr);
+
+    // 清空识别状态，丢弃 endPosition 之前的音频
+    void reset(uint64_t endPosition = UINT64_MAX);
+
+    // 当前窗口的样本数
+    size_t windowSamples() const { return window_.readable(); }
+
+    // 设置窗口上限（样本数，不超过缓冲区容量）
+    void setMaxWindowSamples(size_t samples);
+
+    // 设置两次解码之间的最小新增样本数
+    void setDecodeStepSamples(size_t samples) { decodeStepSamples_ = samples; }
+
+    // 分块编码：audio_ctx 取当前窗口长度按块向上取整，编码器只处理窗口内的音频，
+    // 开销随窗口长度而不是固定的30秒增长，精度略有下降；0 表示使用参数中的 audio_ctx
+    void setEncoderChunkSamples(size_t samples) { encoderChunkSamples_ = samples; }
+
+    // 解码时带入的历史token数上限，0 表示不带上下文
+    void setMaxPromptTokens(size_t tokens);
+
+    // 完成的句子是否同时输出对应音频（用于大模型二次解码）
+    void setCaptureSentenceAudio(bool capture) { captureSentenceAudio_ = capture; }
+
+private:
+    // 带绝对时间（样本）的token
+    struct TimedToken {
+        int32_t id;
+        std::string text;
+        int64_t t0;
+        int64_t t1;
+    };
+
+    // 窗口起点的绝对样本位置
+    int64_t windowStart() const { return (int64_t)window_.readPosition(); }
+
+    // 把窗口起点移动到绝对位置 position
+    void trimWindowTo(int64_t position);
+
+    // 去掉新假设中已被确认的部分
+    void dropCommittedPrefix(std::vector<TimedToken>& hypothesis) const;
+
+    // 从已确认token中切出完整句子
+    void extractSentences(RecognitionUpdate& update);
+
+    // 复制窗口中 [begin, end) 绝对位置的音频
+    void copyAudio(int64_t begin, int64_t end, std::vector<float>& audio) const;
+
+    // 收集本次解码的文本token，时间由 WhisperTokenTimestamps 计算后换算为绝对样本位置
+    void collectTokens(whisper_context* ctx, whisper_state* state, const whisper_full_params& params,
+                       const float* audio, size_t count, std::vector<TimedToken>& tokens);
+
+    // 记录移出窗口的已确认token，作为之后解码的上下文
+    void rememberTokens(const std::vector<TimedToken>& tokens, size_t begin, size_t end);
+
+    // 生成本次解码的提示：历史token加上音频已不在窗口中的已确认token
+    void buildPrompt(const whisper_context* ctx);
+
+    // 拼接token文本
+    static std::string joinTokens(const std::vector<TimedToken>& tokens, size_t begin, size_t end);
+
+    int sampleRate_;
+    size_t maxWindowSamples_;
+    size_t decodeStepSamples_;
+    size_t minDecodeSamples_;
+    size_t encoderChunkSamples_;
+    bool captureSentenceAudio_;
+
+    AudioRingBuffer window_;          // 未输出音频
+    size_t decodedSamples_;           // 上次解码时窗口的长度
+
+    MelFrontend mel_;                 // 窗口的增量 log-mel
+    std::vector<float> melBuffer_;    // 交给 whisper 的归一化 log-mel
+    WhisperTokenTimestamps timestamps_;  // token时间戳（whisper 实现的副本）
+    std::vector<TokenTime> times_;       // 本次解码的token时间
+
+    std::vector<TimedToken> committed_;   // 当前句子已确认的token
+    std::vector<TimedToken> hypothesis_;  // 上次解码未确认的token
+    std::vector<TimedToken> committedTail_;  // 最近确认的token，用于边界去重
+    int64_t committedEnd_;                // 已确认音频的结束位置
+
+    size_t maxPromptTokens_;
+    std::vector<int32_t> promptHistory_;  // 已输出文本的最近token（whisper_token）
+    std::vector<int32_t> prompt_;         // 本次解码的提示
+    const whisper_context* promptContext_;   // 历史token所属的模型，词表不同的模型之间不能混用
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+struct whisper_context;
+struct whisper_state;
+
+// 一个文本token的时间，单位10毫秒，相对解码窗口的起点
+struct TokenTime {
+    int32_t id;
+    int64_t t0;
+    int64_t t1;
+};
+
+// whisper.cpp 的 token 级时间戳算法的副本
+// 流式识别通过 whisper_set_mel_with_state 传入增量计算的 log-mel，whisper_full_with_state 拿不到PCM，
+// whisper 自己不会计算 token 时间戳（没有信号能量时直接返回），因此这里用窗口音频按相同的方法计算。
+// 对应 ggml-org/whisper.cpp src/whisper.cpp 中的 whisper_exp_compute_token_level_timestamps
+// （以及 get_signal_energy、voice_length），照 v1.7 系列的实现移植。
+// 构建脚本拉取的 whisper.cpp 更新后，需要与上游的这几个函数对照，保持一致。
+class WhisperTokenTimestamps {
+public:
+    // 计算 state 中最近一次解码全部片段的文本token时间（跳过特殊token），追加到 tokens。
+    // audio 为解码窗口的 count 个样本，tholdPt/tholdPtsum 与 whisper_full_params 中的同名参数相同
+    void compute(whisper_context* ctx, whisper_state* state, float tholdPt, float tholdPtsum,
+                 const float* audio, size_t count, int sampleRate, std::vector<TokenTime>& tokens);
+
+private:
+    std::vector<float> energy_;   // 窗口音频的短时能量（get_signal_energy）
+};
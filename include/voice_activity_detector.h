@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <functional>
+
+// 语音活动检测（帧能量 + 过零率）
+// 以20毫秒为一帧判断是否为语音，能量阈值跟随自适应的背景噪声。
+// 连续若干语音帧后进入语音段，并补发之前缓存的前导音频；
+// 语音段内连续静音超过设定时长则判定语音结束。语音段之外的音频不送入识别。
+class VoiceActivityDetector {
+public:
+    using SpeechHandler = std::function<void(const float* samples, size_t count)>;
+    using EndHandler = std::function<void()>;
+
+    explicit VoiceActivityDetector(int sampleRate = 16000);
+
+    // 输入音频：语音段内的样本（含前导和尾部静音）交给 onSpeech，语音段结束时调用 onEnd
+    void process(const float* samples, size_t count, const SpeechHandler& onSpeech, const EndHandler& onEnd);
+
+    // 当前是否处于语音段内
+    bool inSpeech() const { return inSpeech_; }
+
+    // 语音结束前允许的最长静音（毫秒）
+    void setEndSilenceMs(int ms);
+
+    // 清空状态
+    void reset();
+
+private:
+    // 判断一帧是否为语音，并更新背景噪声估计
+    bool classifyFrame(const float* frame);
+
+    // 处理一个完整帧
+    void processFrame(const float* frame, const SpeechHandler& onSpeech, const EndHandler& onEnd);
+
+    size_t frameSize_;
+    size_t startFrames_;       // 进入语音段所需的连续语音帧数
+    size_t endFrames_;         // 结束语音段所需的连续静音帧数
+    size_t preRollFrames_;     // 语音开始前保留的帧数
+
+    std::vector<float> pending_;   // 不足一帧的剩余样本
+    std::vector<float> preRoll_;   // 前导音频（按帧循环使用）
+    size_t preRollHead_;           // 最早一帧在 preRoll_ 中的帧序号
+    size_t preRollCount_;          // 已缓存的帧数
+
+    bool inSpeech_;
+    size_t speechRun_;         // 连续语音帧数
+    size_t silenceRun_;        // 连续静音帧数
+    float noiseEnergy_;        // 背景噪声能量估计，小于0表示尚未初始化
+};
@@ -13,7 +13,7 @@ public:
     bool initialize(const std::string& model_path);
     
     // 处理音频数据并返回说话人信息
-    std::string processAudio(const std::vector<float>& audio_data, float sample_rate);
+    std::string processAudio(const float* audio_data, size_t count, float sample_rate);
     
     // 获取当前说话人ID
     std::string getCurrentSpeaker() const;
@@ -37,6 +37,6 @@ private:
     
     // 内部处理函数
     bool loadModel(const std::string& model_path);
-    std::string extractFeatures(const std::vector<float>& audio_data);
+    std::string extractFeatures(const float* audio_data, size_t count);
     std::string identifySpeaker(const std::string& features);
 }; 
\ No newline at end of file
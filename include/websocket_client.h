@@ -1,12 +1,16 @@
 #pragma once
 
 #include <string>
+#include <cstdint>
 #include <vector>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <atomic>
 #include <thread>
+#include "outbound_queue.h"
+#include "permessage_deflate.h"
+#include "input_limits.h"
 
 // 前向声明
 class WebSocketImpl;
@@ -16,20 +20,49 @@ public:
     WebSocketServer();
     ~WebSocketServer();
 
-    // 启动WebSocket服务器
-    bool start(int port = 3000);
+    // 启动WebSocket服务器，ioThreads 为网络I/O线程数（0 表示自动选择）
+    bool start(int port = 3000, int ioThreads = 0);
     
     // 停止服务器
     void stop();
     
-    // 发送文本消息给客户端
-    bool broadcastText(const std::string& message, const std::string& targetClientId = "");
+    // 发送文本消息给客户端，实时结果使用 MessageClass::Partial，客户端跟不上时可以丢弃
+    bool broadcastText(const std::string& message, const std::string& targetClientId = "", MessageClass messageClass = MessageClass::Reliable);
     
     // 发送二进制数据给客户端
     bool broadcastBinary(const std::vector<float>& data, const std::string& targetClientId = "");
     
+    // 设置连接建立回调：握手完成后在连接所属的I/O线程中调用，先于该连接的任何消息回调；
+    // 返回值作为连接的上下文保存到连接关闭，之后该连接的回调都带上它（最后一个参数），不必再按客户端ID查找
+    void setConnectCallback(std::function<std::shared_ptr<void>(const std::string&)> callback);
+    
     // 设置接收消息的回调
-    void setReceiveCallback(std::function<void(const std::string&, const std::string&)> callback);
+    void setReceiveCallback(std::function<void(const std::string&, const std::string&, void*)> callback);
+    
+    // 设置接收二进制消息的回调（负载指针只在回调期间有效）
+    void setBinaryCallback(std::function<void(const uint8_t*, size_t, const std::string&, void*)> callback);
+    
+    // 设置连接关闭回调（在连接所属的I/O线程中调用，之后不会再有该客户端的消息回调）
+    void setDisconnectCallback(std::function<void(const std::string&, void*)> callback);
+    
+    // 设置二进制分片回调：分片发送的未压缩二进制消息每到一片调用一次（first/last 标记第一片和最后一片），
+    // 不在内存中重组；未设置时分片消息重组完整后交给二进制消息回调
+    void setBinaryFragmentCallback(std::function<void(const uint8_t*, size_t, bool, bool, const std::string&, void*)> callback);
+    
+    // 设置每个连接发送队列的限制和慢客户端策略
+    void setOutboundQueueOptions(const OutboundQueueOptions& options);
+    
+    // 发送队列统计
+    OutboundQueueStats outboundQueueStats() const;
+    
+    // 设置permessage-deflate压缩配置，对之后握手的连接生效
+    void setCompressionOptions(const DeflateOptions& options);
+    
+    // 设置输入限制和所有连接共享的内存预算（可以为空），对之后握手的连接生效
+    void setInputLimits(const InputLimits& limits, std::shared_ptr<MemoryBudget> budget);
+    
+    // 输入限制统计
+    InputLimitStats inputLimitStats() const;
     
     // 检查是否正在运行
     bool isRunning() const;
@@ -42,7 +75,7 @@ private:
     std::atomic<bool> running_;
     
     // 接收消息的回调
-    std::function<void(const std::string&, const std::string&)> receiveCallback_;
+    std::function<void(const std::string&, const std::string&, void*)> receiveCallback_;
     
     // 回调互斥锁
     std::mutex callbackMutex_;
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <functional>
+#include <memory>
+#include "input_limits.h"
+
+// WebSocket帧的操作码
+enum OpCode {
+    CONTINUATION = 0x0,
+    TEXT = 0x1,
+    BINARY = 0x2,
+    CLOSE = 0x8,
+    PING = 0x9,
+    PONG = 0xA
+};
+
+// 服务器发出的帧头最大长度：2字节基本头 + 8字节扩展长度（不带掩码）
+constexpr size_t MAX_FRAME_HEADER_SIZE = 10;
+
+// 把帧头写入 out（至少 MAX_FRAME_HEADER_SIZE 字节），返回帧头长度
+// compressed 设置RSV1位，表示负载经过 permessage-deflate 压缩
+size_t encodeFrameHeader(uint8_t* out, bool fin, OpCode opcode, uint64_t payloadLength, bool compressed = false);
+
+// 由服务器发出的帧（不带掩码）的前两个字节得到帧头长度
+size_t frameHeaderSize(const uint8_t* header);
+
+// 用4字节掩码原地异或 length 个字节，offset 为 data 第一个字节在负载中的位置
+// 按16/32字节向量（SSE2/NEON）和8字节整字处理，只有末尾不足8字节的部分逐字节处理
+void unmaskPayload(uint8_t* data, size_t length, const uint8_t* mask, size_t offset = 0);
+
+// 解析出的一个完整帧
+// 负载是视图，指向解析器输入或解析器内部缓冲区，只在 onFrame 回调期间有效
+struct WebSocketFrame {
+    bool fin;
+    bool compressed;            // RSV1位，permessage-deflate 压缩的消息
+    OpCode opcode;
+    const uint8_t* payload;
+    size_t payloadLength;
+};
+
+// WebSocket帧解析状态机
+// 按收到的字节流增量推进：帧头 -> 扩展长度 -> 掩码 -> 负载，
+// 字节可以任意切分到达，一次输入也可以包含多个帧。
+// 完整落在一次输入中的帧在输入缓冲区上原地去掩码，不复制负载；
+// 只有跨越多次输入的帧才累积到连接自己的缓冲区，缓冲区跨帧复用。
+// 帧长度在帧头读完时就与上限比较，累积负载前先从内存预算中预留，超出时停止解析。
+class WebSocketFrameParser {
+public:
+    // 返回 false 时停止解析，同一次输入中剩余的帧不再交付
+    using FrameHandler = std::function<bool(WebSocketFrame&)>;
+
+    // 解析失败的原因
+    enum class Error {
+        None,
+        FrameTooLarge,      // 帧长度超过上限
+        OverBudget,         // 累积负载所需的内存超出预算
+        Protocol,           // 帧头违反协议（客户端帧未加掩码、RSV2/RSV3 置位）
+        Stopped             // onFrame 要求停止（连接已关闭）
+    };
+
+    // 交付后保留的缓冲区容量上限，偶尔的大帧不会让连接长期占用内存
+    static constexpr size_t MAX_RETAINED_BUFFER = 256 * 1024;
+
+    WebSocketFrameParser();
+    ~WebSocketFrameParser();
+
+    WebSocketFrameParser(const WebSocketFrameParser&) = delete;
+    WebSocketFrameParser& operator=(const WebSocketFrameParser&) = delete;
+
+    // 设置单帧负载上限和累积负载使用的内存预算（可以为空）
+    void setLimits(uint64_t maxPayloadLength, std::shared_ptr<MemoryBudget> budget);
+
+    // 输入收到的字节，每解析出一个完整帧调用一次 onFrame
+    // 去掩码直接在 data 上进行，调用后 data 的内容会被修改
+    // 帧超出限制、违反协议或 onFrame 返回 false 时返回 false，之后的输入都被忽略，原因见 error()
+    bool feed(uint8_t* data, size_t length, const FrameHandler& onFrame);
+
+    Error error() const { return error_; }
+
+    // 丢弃未完成的帧，清除错误
+    void reset();
+
+private:
+    enum class State {
+        Header,
+        ExtendedLength,
+        Mask,
+        Payload
+    };
+
+    // 快速路径：data 开头是一个完整的帧时原地解析并交付，返回消耗的字节数；不完整返回0
+    size_t parseComplete(uint8_t* data, size_t length, const FrameHandler& onFrame);
+
+    // 检查帧头前两个字节，违反协议时记录 Error::Protocol
+    bool checkHeader(const uint8_t* header);
+
+    // 帧头完整后根据长度和掩码决定下一个状态
+    void finishHeader(const FrameHandler& onFrame);
+
+    // 负载长度确定后检查上限，需要累积负载时先预留内存
+    bool acceptLength();
+
+    // 归还为当前帧预留的内存
+    void releaseReservation();
+
+    // 负载读完，交付当前帧
+    void deliver(const FrameHandler& onFrame);
+
+    State state_;
+    uint8_t header_[2];
+    uint8_t lengthBytes_[8];
+    size_t lengthSize_;
+    uint8_t mask_[4];
+    bool masked_;
+    size_t filled_;             // 当前状态已读取的字节数
+    uint64_t payloadLength_;
+    std::vector<uint8_t> buffer_;   // 跨越多次输入的帧的负载
+    uint64_t maxPayloadLength_;
+    std::shared_ptr<MemoryBudget> budget_;
+    size_t reserved_;               // 当前帧在预算中预留的字节数
+    Error error_;
+    WebSocketFrame frame_;
+};
@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+"""比较完整编码和分块编码的识别准确率与延迟
+
+按实时速度把WAV文件以二进制音频帧发送给服务器，分别在两种编码器模式下统计：
+  - 错误率：英文按词计算 WER，中日文按字计算 CER（参考文本为同名 .txt 文件）
+  - 首个实时结果延迟：开始发送到收到第一条 L: 的时间
+  - 结束延迟：音频发送完毕到收到最后一条 T: 的时间
+
+用法：
+  python3 benchmark_encoder.py --language zh samples/*.wav
+  python3 benchmark_encoder.py --mode chunked --speed 2 samples/a.wav
+
+服务器端的平均解码耗时会每10秒打印在服务器日志中（流式解码[完整编码] / 流式解码[分块编码]）。
+"""
+import argparse
+import json
+import os
+import struct
+import sys
+import threading
+import time
+import wave
+
+import websocket
+
+CHUNK_MS = 100          # 每个音频帧的时长
+IDLE_TIMEOUT = 3.0      # 音频发送完毕后多久没有新结果认为识别结束
+AUDIO_FORMAT_INT16 = 2
+
+
+def edit_distance(ref, hyp):
+    """ref 与 hyp 两个序列的编辑距离"""
+    previous = list(range(len(hyp) + 1))
+    for i, r in enumerate(ref, 1):
+        current = [i] + [0] * len(hyp)
+        for j, h in enumerate(hyp, 1):
+            current[j] = min(previous[j] + 1, current[j - 1] + 1, previous[j - 1] + (r != h))
+        previous = current
+    return previous[-1]
+
+
+def tokenize(text, by_char):
+    """按字（中日文）或按词（其他语言）切分，忽略标点和大小写"""
+    text = ''.join(c.lower() if c.isalnum() or c.isspace() else ' ' for c in text)
+    if by_char:
+        return [c for c in text if not c.isspace()]
+    return text.split()
+
+
+def read_wav(path):
+    """读取16位PCM WAV，返回 (数据, 采样率, 声道数)，服务器负责混合声道和重采样"""
+    with wave.open(path, 'rb') as f:
+        if f.getsampwidth() != 2:
+            raise ValueError(f"{path}: 只支持16位PCM")
+        return f.readframes(f.getnframes()), f.getframerate(), f.getnchannels()
+
+
+def run_file(url, path, mode, language, speed):
+    pcm, rate, channels = read_wav(path)
+    frame_bytes = 2 * channels
+    chunk_bytes = rate * CHUNK_MS // 1000 * frame_bytes
+
+    finals = []
+    state = {'first_partial': None, 'last_final': None, 'last_message': time.time()}
+    configured = threading.Event()
+
+    def on_message(ws, message):
+        now = time.time()
+        state['last_message'] = now
+        try:
+            data = json.loads(message)
+        except ValueError:
+            return
+        if data.get('type') == 'config_ack':
+            configured.set()
+        elif data.get('type') == 'error_response':
+            print(f"  服务器错误: {data.get('message', data)}", file=sys.stderr)
+            configured.set()
+        elif data.get('type') == 'text_result':
+            text = data.get('data', '')
+            if text.startswith('L:') and state['first_partial'] is None:
+                state['first_partial'] = now
+            elif text.startswith('T:'):
+                finals.append(text[2:])
+                state['last_final'] = now
+
+    ws = websocket.WebSocketApp(url, on_message=on_message)
+    thread = threading.Thread(target=ws.run_forever, daemon=True)
+    thread.start()
+    deadline = time.time() + 5
+    while not (ws.sock and ws.sock.connected) and time.time() < deadline:
+        time.sleep(0.05)
+    ws.send(json.dumps({'type': 'config', 'language': language, 'encoder_mode': mode}))
+    configured.wait(5)
+
+    # 按实时速度（除以 speed）发送
+    start = time.time()
+    sequence = 0
+    for offset in range(0, len(pcm), chunk_bytes):
+        header = struct.pack('<4sBBHII', b'ATPC', 1, AUDIO_FORMAT_INT16, channels, rate, sequence)
+        ws.send(header + pcm[offset:offset + chunk_bytes], opcode=websocket.ABNF.OPCODE_BINARY)
+        sequence += 1
+        target = start + (offset + chunk_bytes) / frame_bytes / rate / speed
+        time.sleep(max(0.0, target - time.time()))
+    audio_end = time.time()
+
+    while time.time() - max(state['last_message'], audio_end) < IDLE_TIMEOUT:
+        time.sleep(0.1)
+    ws.close()
+
+    return {
+        'text': ''.join(finals),
+        'first_partial': state['first_partial'] - start if state['first_partial'] else None,
+        'final_latency': state['last_final'] - audio_end if state['last_final'] else None,
+    }
+
+
+def mean(values):
+    values = [v for v in values if v is not None]
+    return sum(values) / len(values) if values else float('nan')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('files', nargs='+', help='16位PCM WAV文件，参考文本为同名 .txt')
+    parser.add_argument('--host', default='localhost')
+    parser.add_argument('--port', type=int, default=3000)
+    parser.add_argument('--mode', choices=['full', 'chunked', 'both'], default='both')
+    parser.add_argument('--language', default='zh')
+    parser.add_argument('--speed', type=float, default=1.0, help='发送速度相对实时的倍数')
+    args = parser.parse_args()
+
+    url = f"ws://{args.host}:{args.port}"
+    by_char = args.language in ('zh', 'ja')
+    modes = ['full', 'chunked'] if args.mode == 'both' else [args.mode]
+
+    for mode in modes:
+        errors = 0
+        total = 0
+        first_partials = []
+        final_latencies = []
+        for path in args.files:
+            result = run_file(url, path, mode, args.language, args.speed)
+            reference_path = os.path.splitext(path)[0] + '.txt'
+            if os.path.exists(reference_path):
+                with open(reference_path, encoding='utf-8') as f:
+                    reference = tokenize(f.read(), by_char)
+                errors += edit_distance(reference, tokenize(result['text'], by_char))
+                total += len(reference)
+            first_partials.append(result['first_partial'])
+            final_latencies.append(result['final_latency'])
+            print(f"[{mode}] {os.path.basename(path)}: {result['text']}")
+
+        metric = 'CER' if by_char else 'WER'
+        rate = f"{errors / total * 100:.2f}%" if total else 'n/a'
+        print(f"== {mode}: {metric} {rate}，首个实时结果 {mean(first_partials):.2f} 秒，"
+              f"结束延迟 {mean(final_latencies):.2f} 秒（{len(args.files)} 个文件）")
+
+
+if __name__ == '__main__':
+    main()
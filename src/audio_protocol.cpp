@@ -0,0 +1,131 @@
+#include "../include/audio_protocol.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    uint16_t readLE16(const uint8_t *p)
+    {
+        return (uint16_t)(p[0] | (p[1] << 8));
+    }
+
+    uint32_t readLE32(const uint8_t *p)
+    {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    // 读取第 index 个采样点并转换为 [-1, 1] 的float
+    inline float sampleAt(const uint8_t *data, AudioSampleFormat format, size_t index)
+    {
+        if (format == AUDIO_FORMAT_INT16)
+        {
+            return (int16_t)readLE16(data + index * 2) * (1.0f / 32768.0f);
+        }
+        float value;
+        memcpy(&value, data + index * 4, sizeof(value));
+        return value;
+    }
+}
+
+size_t audioSampleSize(AudioSampleFormat format)
+{
+    switch (format)
+    {
+    case AUDIO_FORMAT_FLOAT32:
+        return 4;
+    case AUDIO_FORMAT_INT16:
+        return 2;
+    default:
+        return 0;
+    }
+}
+
+bool isCompressedFormat(AudioSampleFormat format)
+{
+    return format == AUDIO_FORMAT_OPUS;
+}
+
+bool parseAudioPacket(const uint8_t *payload, size_t length, AudioPacket &packet)
+{
+    if (length >= AUDIO_PACKET_HEADER_SIZE && memcmp(payload, "ATPC", 4) == 0)
+    {
+        packet.hasHeader = true;
+        if (payload[4] != AUDIO_PROTOCOL_VERSION)
+        {
+            return false;
+        }
+        packet.format = (AudioSampleFormat)payload[5];
+        packet.channels = readLE16(payload + 6);
+        packet.sampleRate = readLE32(payload + 8);
+        packet.sequence = readLE32(payload + 12);
+        packet.data = payload + AUDIO_PACKET_HEADER_SIZE;
+        packet.size = length - AUDIO_PACKET_HEADER_SIZE;
+    }
+    else
+    {
+        // 旧协议：裸 float32 数据
+        packet.hasHeader = false;
+        packet.format = AUDIO_FORMAT_FLOAT32;
+        packet.channels = 1;
+        packet.sampleRate = 16000;
+        packet.sequence = 0;
+        packet.data = payload;
+        packet.size = length;
+    }
+
+    if (packet.format != AUDIO_FORMAT_FLOAT32 && packet.format != AUDIO_FORMAT_INT16 && packet.format != AUDIO_FORMAT_OPUS)
+    {
+        return false;
+    }
+    if (packet.channels == 0 || packet.sampleRate == 0)
+    {
+        return false;
+    }
+    if (isCompressedFormat(packet.format))
+    {
+        return packet.size > 0;
+    }
+    return packet.size % (audioSampleSize(packet.format) * packet.channels) == 0;
+}
+
+size_t decodePcm(const AudioPacket &packet, std::vector<float> &out)
+{
+    const size_t frames = packet.size / (audioSampleSize(packet.format) * packet.channels);
+    const size_t offset = out.size();
+    out.resize(offset + frames);
+    return decodePcm(packet, out.data() + offset, frames);
+}
+
+size_t decodePcm(const AudioPacket &packet, float *dst, size_t maxFrames)
+{
+    const size_t frames = std::min(maxFrames, packet.size / (audioSampleSize(packet.format) * packet.channels));
+
+    if (packet.channels == 1)
+    {
+        if (packet.format == AUDIO_FORMAT_FLOAT32)
+        {
+            memcpy(dst, packet.data, frames * sizeof(float));
+        }
+        else
+        {
+            for (size_t i = 0; i < frames; ++i)
+            {
+                dst[i] = sampleAt(packet.data, AUDIO_FORMAT_INT16, i);
+            }
+        }
+        return frames;
+    }
+
+    // 多声道取平均混为单声道
+    const float scale = 1.0f / packet.channels;
+    for (size_t i = 0; i < frames; ++i)
+    {
+        float sum = 0.0f;
+        for (size_t c = 0; c < packet.channels; ++c)
+        {
+            sum += sampleAt(packet.data, packet.format, i * packet.channels + c);
+        }
+        dst[i] = sum * scale;
+    }
+    return frames;
+}
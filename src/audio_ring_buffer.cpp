@@ -0,0 +1,89 @@
+#include "../include/audio_ring_buffer.h"
+#include <algorithm>
+#include <cstring>
+
+AudioRingBuffer::AudioRingBuffer(size_t minCapacity)
+    : capacity_(1),
+      writePos_(0),
+      readPos_(0)
+{
+    while (capacity_ < minCapacity)
+    {
+        capacity_ <<= 1;
+    }
+    mask_ = capacity_ - 1;
+    storage_.resize(capacity_ * 2);
+}
+
+size_t AudioRingBuffer::write(const float *samples, size_t count)
+{
+    const uint64_t w = writePos_.load(std::memory_order_relaxed);
+    const uint64_t r = readPos_.load(std::memory_order_acquire);
+    const size_t n = std::min(count, capacity_ - (size_t)(w - r));
+    if (n == 0)
+    {
+        return 0;
+    }
+
+    // 同时写入主区和镜像区，绕回部分写到两个区的开头
+    const size_t pos = (size_t)(w & mask_);
+    const size_t first = std::min(n, capacity_ - pos);
+    float *base = storage_.data();
+    memcpy(base + pos, samples, first * sizeof(float));
+    memcpy(base + pos + capacity_, samples, first * sizeof(float));
+    if (n > first)
+    {
+        memcpy(base, samples + first, (n - first) * sizeof(float));
+        memcpy(base + capacity_, samples + first, (n - first) * sizeof(float));
+    }
+
+    writePos_.store(w + n, std::memory_order_release);
+    return n;
+}
+
+float *AudioRingBuffer::writeRegion(size_t count, size_t &available)
+{
+    const uint64_t w = writePos_.load(std::memory_order_relaxed);
+    const uint64_t r = readPos_.load(std::memory_order_acquire);
+    available = std::min(count, capacity_ - (size_t)(w - r));
+
+    // 存储区是容量的两倍，从主区任意位置开始、不超过容量的区域都是连续的
+    return storage_.data() + (w & mask_);
+}
+
+void AudioRingBuffer::commit(size_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // 区域落在主区的部分复制到镜像区，越过主区末尾、写进镜像区的部分复制回主区开头
+    const uint64_t w = writePos_.load(std::memory_order_relaxed);
+    const size_t pos = (size_t)(w & mask_);
+    const size_t first = std::min(count, capacity_ - pos);
+    float *base = storage_.data();
+    memcpy(base + pos + capacity_, base + pos, first * sizeof(float));
+    if (count > first)
+    {
+        memcpy(base, base + capacity_, (count - first) * sizeof(float));
+    }
+
+    writePos_.store(w + count, std::memory_order_release);
+}
+
+size_t AudioRingBuffer::readable() const
+{
+    return (size_t)(writePos_.load(std::memory_order_acquire) - readPos_.load(std::memory_order_relaxed));
+}
+
+const float *AudioRingBuffer::data() const
+{
+    return storage_.data() + (readPos_.load(std::memory_order_relaxed) & mask_);
+}
+
+void AudioRingBuffer::consume(size_t count)
+{
+    const uint64_t r = readPos_.load(std::memory_order_relaxed);
+    readPos_.store(r + std::min(count, readable()), std::memory_order_release);
+}
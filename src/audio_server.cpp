@@ -1,15 +1,23 @@
 #include "../include/audio_server.h"
 #include "../include/websocket_client.h"
+#include "../include/audio_protocol.h"
+#include "../include/voiceprint_recognition.h"
+#include "../include/opus_stream_decoder.h"
+#include "../include/polyphase_resampler.h"
 #include <iostream>
 #include <functional>
 #include <chrono>
 #include <algorithm>
+#include <cstring>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
 
 AudioServer::AudioServer()
-    : server_(nullptr), running_(false), connected_(false), host_("localhost"), port_(3000)
+    : server_(nullptr), maxMessageBytes_(InputLimits().maxMessageBytes),
+      memoryBudget_(std::make_shared<MemoryBudget>(InputLimits().memoryBudget)),
+      running_(false), connected_(false), host_("localhost"), port_(3000),
+      lastStatsLog_(std::chrono::steady_clock::now().time_since_epoch().count())
 {
 }
 
@@ -25,10 +33,20 @@ bool AudioServer::initialize(const std::string &host, int port)
 
     // 创建WebSocket服务器
     server_ = std::make_shared<WebSocketServer>();
+    {
+        std::lock_guard<std::mutex> lock(limitsMutex_);
+        server_->setInputLimits(inputLimits_, memoryBudget_);
+    }
 
-    // 设置消息接收回调
-    server_->setReceiveCallback([this](const std::string &message, const std::string &clientId)
-                                { handleIncomingMessage(message, clientId); });
+    // 设置消息接收回调，每个连接的流状态作为连接上下文随回调传入
+    server_->setConnectCallback([this](const std::string &clientId)
+                                { return handleConnect(clientId); });
+    server_->setReceiveCallback([this](const std::string &message, const std::string &, void *context)
+                                { handleIncomingMessage(message, *static_cast<ClientStream *>(context)); });
+    server_->setBinaryCallback([this](const uint8_t *data, size_t length, const std::string &, void *context)
+                               { handleBinaryMessage(data, length, *static_cast<ClientStream *>(context)); });
+    server_->setDisconnectCallback([this](const std::string &, void *context)
+                                   { handleDisconnect(*static_cast<ClientStream *>(context)); });
 
     // 启动服务器
     if (!server_->start(port_))
@@ -42,7 +60,7 @@ bool AudioServer::initialize(const std::string &host, int port)
     return true;
 }
 
-bool AudioServer::start(std::function<void(const std::vector<float> &, const std::string &)> callback)
+bool AudioServer::start()
 {
     if (!connected_)
     {
@@ -50,12 +68,8 @@ bool AudioServer::start(std::function<void(const std::vector<float> &, const std
         return false;
     }
 
-    audioCallback_ = callback;
+    // 音频在各个连接的I/O线程中直接写入会话，不需要单独的处理线程
     running_ = true;
-
-    // 启动处理线程
-    processingThread_ = std::thread(&AudioServer::processAudioData, this);
-
     return true;
 }
 
@@ -63,16 +77,7 @@ void AudioServer::stop()
 {
     running_ = false;
 
-    // 通知处理线程停止
-    queueCondition_.notify_all();
-
-    // 等待处理线程结束
-    if (processingThread_.joinable())
-    {
-        processingThread_.join();
-    }
-
-    // 停止WebSocket服务器
+    // 停止WebSocket服务器，仍然连接的客户端的会话随之关闭
     if (server_)
     {
         server_->stop();
@@ -122,8 +127,8 @@ void AudioServer::sendTextResult(const std::string &text, bool isComplete, const
             {"type", "text_result"},
             {"data", prefixedText}};
 
-        // 发送JSON消息
-        server_->broadcastText(message.dump(), targetClientId);
+        // 发送JSON消息，实时结果在客户端跟不上时可以被丢弃或合并
+        server_->broadcastText(message.dump(), targetClientId, isComplete ? MessageClass::Reliable : MessageClass::Partial);
     }
     catch (const std::exception &e)
     {
@@ -131,43 +136,138 @@ void AudioServer::sendTextResult(const std::string &text, bool isComplete, const
     }
 }
 
-void AudioServer::processAudioData()
+void AudioServer::setOutboundQueueOptions(const OutboundQueueOptions &options)
 {
-    while (running_)
+    if (server_)
     {
-        AudioData audioData;
-        bool hasData = false;
+        server_->setOutboundQueueOptions(options);
+    }
+}
 
-        // 使用条件变量等待新的音频数据
-        {
-            std::unique_lock<std::mutex> lock(queueMutex_);
-            queueCondition_.wait(lock, [this]
-                                 { return !audioQueue_.empty() || !running_; });
+void AudioServer::setCompressionOptions(const DeflateOptions &options)
+{
+    if (server_)
+    {
+        server_->setCompressionOptions(options);
+    }
+}
 
-            // 检查是否需要退出
-            if (!running_ && audioQueue_.empty())
-            {
-                break;
-            }
+void AudioServer::setInputLimits(const InputLimits &limits)
+{
+    std::lock_guard<std::mutex> lock(limitsMutex_);
+    inputLimits_ = limits;
+    maxMessageBytes_ = limits.maxMessageBytes;
+    memoryBudget_->setLimit(limits.memoryBudget);
+    if (server_)
+    {
+        server_->setInputLimits(limits, memoryBudget_);
+    }
+}
 
-            // 获取队列中的音频数据
-            if (!audioQueue_.empty())
-            {
-                audioData = std::move(audioQueue_.front());
-                audioQueue_.pop();
-                hasData = true;
-            }
-        }
+InputLimitStats AudioServer::inputLimitStats() const
+{
+    InputLimitStats stats;
+    if (server_)
+    {
+        stats = server_->inputLimitStats();
+    }
+    stats.budgetRejects += audioBudgetRejects_;
+    stats.droppedAudioPackets = droppedAudioPackets_;
+    stats.budgetUsed = memoryBudget_->used();
+    return stats;
+}
 
-        // 处理音频数据
-        if (hasData && audioCallback_)
-        {
-            audioCallback_(audioData.buffer, audioData.clientId);
-        }
+void AudioServer::setStreamFragments(bool enabled)
+{
+    if (!server_)
+    {
+        return;
+    }
+    if (enabled)
+    {
+        server_->setBinaryFragmentCallback([this](const uint8_t *data, size_t length, bool first, bool last, const std::string &, void *context)
+                                           { handleBinaryFragment(data, length, first, last, *static_cast<ClientStream *>(context)); });
+    }
+    else
+    {
+        server_->setBinaryFragmentCallback(nullptr);
+    }
+}
+
+void AudioServer::setConnectCallback(std::function<AudioSink(const std::string &)> callback)
+{
+    std::lock_guard<std::mutex> lock(configCallbackMutex_);
+    connectCallback_ = callback;
+}
+
+void AudioServer::setConfigCallback(std::function<void(const SessionConfig &, const std::string &, std::function<void(bool)>)> callback)
+{
+    std::lock_guard<std::mutex> lock(configCallbackMutex_);
+    configCallback_ = callback;
+}
+
+void AudioServer::logDecodeStats()
+{
+    // 各个I/O线程都会调用，到期时只由抢到的一个线程输出
+    const int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+    int64_t last = lastStatsLog_;
+    const std::chrono::steady_clock::duration elapsed(now - last);
+    if (elapsed < std::chrono::seconds(10) || !lastStatsLog_.compare_exchange_strong(last, now))
+    {
+        return;
+    }
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    logInputLimitStats();
+
+    const uint64_t packets = opusPackets_;
+    if (packets == loggedOpusPackets_)
+    {
+        return;
+    }
+    loggedOpusPackets_ = packets;
+
+    // 解码耗时占音频时长的比例，以及平均入流量
+    const uint64_t samples = opusSamples_;
+    const double audioSeconds = (double)samples / OpusStreamDecoder::OUTPUT_SAMPLE_RATE;
+    const double decodeSeconds = opusDecodeNanos_ / 1e9;
+    const uint64_t bytes = opusBytes_.exchange(0);
+    std::cout << "Opus解码: 累计 " << packets << " 包，音频 " << (uint64_t)audioSeconds << " 秒"
+              << "，解码耗时占比 " << (audioSeconds > 0 ? decodeSeconds / audioSeconds * 100.0 : 0.0) << "%"
+              << "，丢包补偿 " << opusConcealedSamples_ / (OpusStreamDecoder::OUTPUT_SAMPLE_RATE / 1000) << " 毫秒"
+              << "，解码失败 " << opusErrors_
+              << "，入流量 " << (uint64_t)(bytes / 1024 / seconds) << " KB/s" << std::endl;
+}
+
+void AudioServer::logInputLimitStats()
+{
+    const uint64_t dropped = droppedAudioPackets_;
+    const uint64_t budgetRejects = audioBudgetRejects_;
+    if (dropped + budgetRejects == loggedAudioRejects_)
+    {
+        return;
     }
+    loggedAudioRejects_ = dropped + budgetRejects;
+    std::cout << "音频输入限制: 累计丢弃积压超限的音频帧 " << dropped
+              << "，超出内存预算 " << budgetRejects
+              << "，当前预留 " << memoryBudget_->used() / 1024 << " KB" << std::endl;
 }
 
-void AudioServer::handleIncomingMessage(const std::string &message, const std::string &clientId)
+std::shared_ptr<void> AudioServer::handleConnect(const std::string &clientId)
+{
+    std::shared_ptr<ClientStream> stream = std::make_shared<ClientStream>(clientId);
+    std::function<AudioSink(const std::string &)> callback;
+    {
+        std::lock_guard<std::mutex> lock(configCallbackMutex_);
+        callback = connectCallback_;
+    }
+    if (callback)
+    {
+        stream->sink = callback(clientId);
+    }
+    return stream;
+}
+
+void AudioServer::handleIncomingMessage(const std::string &message, ClientStream &stream)
 {
     try
     {
@@ -179,32 +279,25 @@ void AudioServer::handleIncomingMessage(const std::string &message, const std::s
 
         if (type == "audio_data")
         {
-            // 从JSON解析音频数据
-            std::vector<float> audioBuffer;
-
             // 获取数据数组
-            json data_array = json_msg["data"];
+            const json &data_array = json_msg["data"];
 
-            // 将JSON数组转换为浮点数数组
+            // 将JSON数组转换为浮点数数组，解码缓冲区跨消息复用
+            stream.decoded.clear();
             for (const auto &item : data_array)
             {
-                audioBuffer.push_back(item.get<float>());
+                stream.decoded.push_back(item.get<float>());
             }
 
-            // 将音频数据添加到队列
-            if (!audioBuffer.empty())
-            {
-                AudioData data;
-                data.buffer = std::move(audioBuffer);
-                data.clientId = clientId;
-                
-                std::lock_guard<std::mutex> lock(queueMutex_);
-                audioQueue_.push(std::move(data));
-                queueCondition_.notify_one();
-            }
+            // 将音频数据写入会话
+            writeAudio(stream, stream.decoded.data(), stream.decoded.size());
 
             // std::cout << "收到音频数据，数据长度: " << data_array.size() << std::endl;
         }
+        else if (type == "config")
+        {
+            handleConfigMessage(json_msg, stream.clientId);
+        }
     }
     catch (const json::exception &e)
     {
@@ -213,16 +306,381 @@ void AudioServer::handleIncomingMessage(const std::string &message, const std::s
         std::cout << "接收到的消息可能包含无效UTF-8字符" << std::endl;
 
         // 如果需要，可以回复一个简单的确认消息
+        sendError("消息解析失败，可能包含无效字符", stream.clientId);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "处理接收消息失败: " << e.what() << std::endl;
+    }
+}
+
+void AudioServer::handleConfigMessage(const json &message, const std::string &clientId)
+{
+    // 未出现的字段保持默认值
+    SessionConfig config;
+    config.language = message.value("language", config.language);
+    config.model = message.value("model", config.model);
+    config.draftModel = message.value("draft_model", config.draftModel);
+    config.beamSize = message.value("beam_size", config.beamSize);
+    config.audioCtx = message.value("audio_ctx", config.audioCtx);
+    config.maxTokens = message.value("max_tokens", config.maxTokens);
+    config.translate = message.value("translate", config.translate);
+    config.promptTokens = message.value("prompt_tokens", config.promptTokens);
+    config.encoderMode = message.value("encoder_mode", config.encoderMode);
+
+    if (config.beamSize < 1 || config.beamSize > MAX_BEAM_SIZE)
+    {
+        sendError("beam_size 超出范围 (1-" + std::to_string(MAX_BEAM_SIZE) + ")", clientId);
+        return;
+    }
+    if (config.audioCtx < 0 || config.audioCtx > MAX_AUDIO_CTX)
+    {
+        sendError("audio_ctx 超出范围 (0-" + std::to_string(MAX_AUDIO_CTX) + ")", clientId);
+        return;
+    }
+    if (config.promptTokens < 0 || config.promptTokens > MAX_PROMPT_TOKENS)
+    {
+        sendError("prompt_tokens 超出范围 (0-" + std::to_string(MAX_PROMPT_TOKENS) + ")", clientId);
+        return;
+    }
+    if (!config.encoderMode.empty() && config.encoderMode != "full" && config.encoderMode != "chunked")
+    {
+        sendError("encoder_mode 只能是 full 或 chunked", clientId);
+        return;
+    }
+    if (config.maxTokens < 0 || config.maxTokens > MAX_SEGMENT_TOKENS)
+    {
+        sendError("max_tokens 超出范围 (0-" + std::to_string(MAX_SEGMENT_TOKENS) + ")", clientId);
+        return;
+    }
+
+    std::function<void(const SessionConfig &, const std::string &, std::function<void(bool)>)> callback;
+    {
+        std::lock_guard<std::mutex> lock(configCallbackMutex_);
+        callback = configCallback_;
+    }
+    if (!callback)
+    {
+        sendError("不支持的识别配置", clientId);
+        return;
+    }
+
+    // 配置生效（可能在模型加载完成之后）时回复实际生效的配置
+    callback(config, clientId, [this, config, clientId](bool accepted)
+             {
+        if (!accepted)
+        {
+            sendError("不支持的识别配置", clientId);
+            return;
+        }
+        json ack = {
+            {"type", "config_ack"},
+            {"config", {{"language", config.language}, {"model", config.model}, {"draft_model", config.draftModel}, {"beam_size", config.beamSize}, {"audio_ctx", config.audioCtx}, {"max_tokens", config.maxTokens}, {"translate", config.translate}, {"prompt_tokens", config.promptTokens}, {"encoder_mode", config.encoderMode}}}};
+        if (connected_ && server_)
+        {
+            server_->broadcastText(ack.dump(), clientId);
+        } });
+}
+
+void AudioServer::handleDisconnect(ClientStream &stream)
+{
+    releaseFragmentReservation(stream.fragment, 0);
+
+    // 该客户端的音频都已在当前I/O线程中写入会话，可以直接关闭
+    if (stream.sink.close)
+    {
+        stream.sink.close();
+    }
+}
+
+void AudioServer::handleBinaryMessage(const uint8_t *data, size_t length, ClientStream &stream)
+{
+    AudioPacket packet;
+    if (!parseAudioPacket(data, length, packet))
+    {
+        sendError("不支持的二进制音频格式", stream.clientId);
+        return;
+    }
+    handleAudioPacket(packet, stream);
+}
+
+void AudioServer::handleBinaryFragment(const uint8_t *data, size_t length, bool first, bool last, ClientStream &stream)
+{
+    // 同一连接的分片由同一个I/O线程依次交付，分片状态直接在连接的流状态中更新
+    FragmentState &state = stream.fragment;
+    if (first)
+    {
+        releaseFragmentReservation(state, 0);
+        state = FragmentState();
+    }
+    if (state.discard)
+    {
+        if (last)
+        {
+            state = FragmentState();
+        }
+        return;
+    }
+
+    // 未处理的字节与网络层的输入缓冲共用内存预算，追加之前先预留
+    if (!memoryBudget_->tryReserve(length))
+    {
+        ++audioBudgetRejects_;
+        sendError("分片音频消息超出内存预算", stream.clientId);
+        releaseFragmentReservation(state, 0);
+        state.pending.clear();
+        state.discard = true;
+        if (last)
+        {
+            state = FragmentState();
+        }
+        return;
+    }
+    state.reserved += length;
+    state.pending.insert(state.pending.end(), data, data + length);
+
+    // 头部到齐后确定格式
+    if (!state.headerParsed)
+    {
+        if (state.pending.size() < AUDIO_PACKET_HEADER_SIZE && !last)
+        {
+            return;
+        }
+        state.headerParsed = true;
+        if (state.pending.size() >= AUDIO_PACKET_HEADER_SIZE && memcmp(state.pending.data(), "ATPC", 4) == 0)
+        {
+            state.headerSize = AUDIO_PACKET_HEADER_SIZE;
+            state.whole = isCompressedFormat((AudioSampleFormat)state.pending[5]);
+        }
+    }
+
+    const size_t maxMessageBytes = maxMessageBytes_;
+    if (state.whole)
+    {
+        // Opus包不能拆开解码，收齐后按普通消息处理
+        if (state.pending.size() > maxMessageBytes)
+        {
+            sendError("分片音频消息超过长度上限", stream.clientId);
+            state.pending.clear();
+            state.discard = true;
+        }
+        else if (last)
+        {
+            handleBinaryMessage(state.pending.data(), state.pending.size(), stream);
+        }
+    }
+    else
+    {
+        // PCM按完整的采样帧处理，不足一帧的字节留给下一片
+        AudioPacket packet;
+        if (!parseAudioPacket(state.pending.data(), state.headerSize, packet))
+        {
+            sendError("不支持的二进制音频格式", stream.clientId);
+            state.discard = true;
+        }
+        else
+        {
+            const size_t frameBytes = audioSampleSize(packet.format) * packet.channels;
+            const size_t body = state.pending.size() - state.headerSize;
+            const size_t usable = body - body % frameBytes;
+            if (last && usable != body)
+            {
+                sendError("分片音频消息的长度不是完整的采样帧", stream.clientId);
+            }
+            if (usable > 0)
+            {
+                packet.data = state.pending.data() + state.headerSize;
+                packet.size = usable;
+                packet.hasHeader = packet.hasHeader && !state.delivered;
+                state.delivered = true;
+                handleAudioPacket(packet, stream);
+                auto begin = state.pending.begin() + state.headerSize;
+                state.pending.erase(begin, begin + usable);
+            }
+        }
+    }
+
+    // 消息结束或被丢弃时归还全部预留，否则只保留仍在 pending 中的字节
+    if (last || state.discard)
+    {
+        state.pending.clear();
+    }
+    releaseFragmentReservation(state, state.pending.size());
+
+    if (last)
+    {
+        state = FragmentState();
+    }
+}
+
+void AudioServer::releaseFragmentReservation(FragmentState &state, size_t keep)
+{
+    if (state.reserved > keep)
+    {
+        memoryBudget_->release(state.reserved - keep);
+        state.reserved = keep;
+    }
+}
+
+void AudioServer::handleAudioPacket(const AudioPacket &packet, ClientStream &stream)
+{
+    if (!stream.sink.prepare)
+    {
+        return;
+    }
+
+    std::string speaker;
+    if (packet.format == AUDIO_FORMAT_OPUS)
+    {
+        // Opus直接解码为16kHz单声道
+        stream.decoded.clear();
+        if (!decodeOpusPacket(packet, stream, stream.decoded) || stream.decoded.empty())
+        {
+            return;
+        }
+        speaker = VoiceprintRecognition::getInstance().processAudio(stream.decoded.data(), stream.decoded.size(), 16000.0f);
+        writeAudio(stream, stream.decoded.data(), stream.decoded.size());
+    }
+    else if (packet.sampleRate == 16000)
+    {
+        // 16kHz PCM从帧负载直接转换到会话的写入区域，不经过中间缓冲区
+        const size_t frames = packet.size / (audioSampleSize(packet.format) * packet.channels);
+        if (frames == 0)
+        {
+            return;
+        }
+        size_t available = 0;
+        float *region = stream.sink.prepare(frames, available);
+        const size_t written = decodePcm(packet, region, available);
+        speaker = VoiceprintRecognition::getInstance().processAudio(region, written, 16000.0f);
+        commitAudio(stream, written, frames - written);
+    }
+    else
+    {
+        if (!PolyphaseResampler::supported((int)packet.sampleRate))
+        {
+            sendError("不支持的采样率: " + std::to_string(packet.sampleRate), stream.clientId);
+            return;
+        }
+
+        // 其他采样率先混合为单声道，重采样后再写入
+        stream.decoded.clear();
+        if (decodePcm(packet, stream.decoded) == 0 || !resamplePcm(packet, stream, stream.decoded))
+        {
+            return;
+        }
+        speaker = VoiceprintRecognition::getInstance().processAudio(stream.decoded.data(), stream.decoded.size(), 16000.0f);
+        writeAudio(stream, stream.decoded.data(), stream.decoded.size());
+    }
+
+    // 序号检查，记录说话人变化
+    if (packet.hasHeader)
+    {
+        if (stream.started && packet.sequence != stream.nextSequence)
+        {
+            std::cout << "音频帧序号不连续 (ClientID: " << stream.clientId << "): 期望 "
+                      << stream.nextSequence << "，收到 " << packet.sequence << std::endl;
+        }
+        stream.started = true;
+        stream.nextSequence = packet.sequence + 1;
+    }
+
+    // 发送说话人信息给客户端
+    if (speaker != "unknown" && speaker != stream.speaker)
+    {
+        stream.speaker = speaker;
         if (connected_ && server_)
         {
-            json reply = {
-                {"type", "error_response"},
-                {"message", "消息解析失败，可能包含无效字符"}};
-            server_->broadcastText(reply.dump(), clientId);
+            json info = {
+                {"type", "speaker"},
+                {"speaker", speaker}};
+            server_->broadcastText(info.dump(), stream.clientId);
         }
     }
-    catch (const std::exception &e)
+
+    logDecodeStats();
+}
+
+bool AudioServer::resamplePcm(const AudioPacket &packet, ClientStream &stream, std::vector<float> &audio)
+{
+    // 每个流一个重采样器，保留块之间的滤波器历史；滤波器组按比例全局共享
+    if (!stream.resampler || stream.resampler->inputRate() != (int)packet.sampleRate)
     {
-        std::cerr << "处理接收消息失败: " << e.what() << std::endl;
+        stream.resampler = std::make_shared<PolyphaseResampler>((int)packet.sampleRate);
+    }
+
+    stream.resampled.clear();
+    stream.resampler->process(audio.data(), audio.size(), stream.resampled);
+    audio.swap(stream.resampled);
+    return !audio.empty();
+}
+
+bool AudioServer::decodeOpusPacket(const AudioPacket &packet, ClientStream &stream, std::vector<float> &out)
+{
+    if (!OpusStreamDecoder::supported())
+    {
+        sendError("服务器未启用Opus解码", stream.clientId);
+        return false;
+    }
+
+    // 每个流一个解码器，序号跳过的包先做丢包补偿
+    if (!stream.opusDecoder)
+    {
+        stream.opusDecoder = std::make_shared<OpusStreamDecoder>();
+    }
+    size_t lostPackets = 0;
+    if (stream.started && packet.sequence > stream.nextSequence)
+    {
+        lostPackets = packet.sequence - stream.nextSequence;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    int concealed = stream.opusDecoder->conceal(lostPackets, out);
+    int samples = stream.opusDecoder->decode(packet.data, packet.size, out);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    opusDecodeNanos_ += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    opusBytes_ += packet.size;
+    opusConcealedSamples_ += (uint64_t)concealed;
+    if (samples < 0)
+    {
+        ++opusErrors_;
+        return concealed > 0;
+    }
+    ++opusPackets_;
+    opusSamples_ += (uint64_t)(samples + concealed);
+    return true;
+}
+
+void AudioServer::writeAudio(ClientStream &stream, const float *samples, size_t count)
+{
+    if (count == 0 || !stream.sink.prepare)
+    {
+        return;
+    }
+    size_t available = 0;
+    float *region = stream.sink.prepare(count, available);
+    memcpy(region, samples, available * sizeof(float));
+    commitAudio(stream, available, count - available);
+}
+
+void AudioServer::commitAudio(ClientStream &stream, size_t written, size_t dropped)
+{
+    // 识别跟不上时音频在会话的环形缓冲区中积压，缓冲区满时丢弃新到的音频
+    stream.sink.commit(written, dropped);
+    if (dropped > 0)
+    {
+        ++droppedAudioPackets_;
+    }
+}
+
+void AudioServer::sendError(const std::string &message, const std::string &clientId)
+{
+    if (connected_ && server_)
+    {
+        json reply = {
+            {"type", "error_response"},
+            {"message", message}};
+        server_->broadcastText(reply.dump(), clientId);
     }
 }
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "../include/decoder_pool.h"
+#include <algorithm>
+#include <iostream>
+
+DecoderPool::DecoderPool()
+    : threadsPerWorker_(1), nextSequence_(0), running_(false)
+{
+}
+
+DecoderPool::~DecoderPool()
+{
+    stop();
+}
+
+bool DecoderPool::start(int workers, int threadsPerWorker)
+{
+    if (running_ || workers <= 0)
+    {
+        return false;
+    }
+
+    threadsPerWorker_ = threadsPerWorker > 0 ? threadsPerWorker : 1;
+
+    running_ = true;
+    for (int i = 0; i < workers; ++i)
+    {
+        workers_.emplace_back(&DecoderPool::workerLoop, this);
+    }
+
+    std::cout << "解码工作池已启动: " << workers << " 个工作线程，每个 "
+              << threadsPerWorker_ << " 个计算线程" << std::endl;
+    return true;
+}
+
+void DecoderPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+        jobs_.clear();
+    }
+    condition_.notify_all();
+
+    for (std::thread &worker : workers_)
+    {
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+    workers_.clear();
+}
+
+bool DecoderPool::RunsAfter::operator()(const Task &a, const Task &b) const
+{
+    if (a.priority != b.priority)
+    {
+        return a.priority > b.priority;
+    }
+    if (a.deadline != b.deadline)
+    {
+        return a.deadline > b.deadline;
+    }
+    return a.sequence > b.sequence;
+}
+
+bool DecoderPool::submit(std::shared_ptr<WhisperModel> model, DecodeJob job,
+                         DecodePriority priority, std::chrono::steady_clock::time_point deadline)
+{
+    if (!model)
+    {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_)
+        {
+            return false;
+        }
+        jobs_.push_back(Task{std::move(model), std::move(job), priority, deadline, nextSequence_++});
+        std::push_heap(jobs_.begin(), jobs_.end(), RunsAfter());
+    }
+    condition_.notify_one();
+    return true;
+}
+
+void DecoderPool::workerLoop()
+{
+    while (true)
+    {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this]
+                            { return !jobs_.empty() || !running_; });
+            if (!running_)
+            {
+                break;
+            }
+            std::pop_heap(jobs_.begin(), jobs_.end(), RunsAfter());
+            task = std::move(jobs_.back());
+            jobs_.pop_back();
+        }
+
+        // 无法创建解码状态时仍执行任务（state 为空），由任务自行放弃解码并清理
+        whisper_state *state = task.model->acquireState();
+        try
+        {
+            task.job(task.model->context(), state);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "解码任务出错: " << e.what() << std::endl;
+        }
+        if (state != nullptr)
+        {
+            task.model->releaseState(state);
+        }
+    }
+}
@@ -11,6 +11,7 @@
 #include <atomic>
 #include <signal.h>
 #include <cstring>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <locale>
@@ -24,9 +25,15 @@
 #include <condition_variable>
 #include <algorithm>
 #include <map>
+#include <memory>
 
 #include "../include/audio_server.h"
 #include "../include/system_monitor.h"
+#include "../include/streaming_recognizer.h"
+#include "../include/decoder_pool.h"
+#include "../include/model_registry.h"
+#include "../include/voice_activity_detector.h"
+#include "../include/session_config.h"
 #include "../whisper.cpp/include/whisper.h"
 
 // Constants
@@ -36,33 +43,129 @@ constexpr int FRAME_SIZE = 512;
 constexpr int MAX_BUFFER_SIZE = SAMPLE_RATE * 30;   // 30 seconds of audio
 constexpr int AUDIO_CONTEXT_SIZE = SAMPLE_RATE * 1; // 3 seconds context
 constexpr int MIN_AUDIO_SAMPLES = SAMPLE_RATE;      // 至少1秒的音频数据
+constexpr int ENCODER_CHUNK_SAMPLES = SAMPLE_RATE * 2; // 分块编码时 audio_ctx 的取整粒度（2秒）
 
 // Global variables
 std::atomic<bool> running(true);
 std::deque<float> audioBuffer;
-std::mutex bufferMutex;
-whisper_context *ctx = nullptr;
+ModelRegistry *modelRegistry = nullptr;
+DecoderPool *decoderPool = nullptr;
 SystemMonitor *systemMonitor = nullptr;
 AudioServer *audioServer = nullptr;
-
-// 使用标准队列替代 boost 无锁队列
-const size_t AUDIO_QUEUE_SIZE = 1024; // 队列大小
-std::queue<AudioData> audioQueue;
-std::mutex audioQueueMutex;
-
-// 音频处理相关的全局变量
-std::mutex userDataMutex;
-std::map<std::string, std::vector<float>> audio_chunks;
-std::map<std::string, std::vector<float>::iterator> audio_chunk_begins;
-std::map<std::string, size_t> audio_chunk_lasts;
-std::string confirmInfo;
+bool vadEnabled = true; // 是否用语音活动检测过滤静音
+size_t sessionBufferSamples = MAX_BUFFER_SIZE; // 每个会话环形缓冲区的容量：识别窗口加上允许积压的音频
+std::string defaultDraftModel; // 默认草稿模型，为空时只用一个模型解码
+std::string defaultEncoderMode = "full"; // 会话未指定时的编码器模式
+
+// 会话的识别参数：使用的模型、配置及据此预先生成的 whisper 参数
+// 设置了草稿模型时为两遍解码：草稿模型负责流式窗口和实时结果（L:），
+// 确认的句子再交给 model 重新解码，作为最终结果（T:）。
+// 持有模型引用，会话使用期间模型不会被卸载；
+// params.language 指向 config 中的字符串，因此不可复制，以 shared_ptr 共享
+struct RecognitionParams
+{
+    std::shared_ptr<WhisperModel> model;
+    std::shared_ptr<WhisperModel> draftModel; // 为空时 model 同时产生实时结果和最终结果
+    SessionConfig config;
+    whisper_full_params params;      // 流式解码参数
+    whisper_full_params finalParams; // 整句重新解码参数
+    bool chunkedEncoder;             // 流式解码是否使用分块编码
+
+    RecognitionParams(std::shared_ptr<WhisperModel> sessionModel, std::shared_ptr<WhisperModel> sessionDraftModel,
+                      const SessionConfig &sessionConfig, int threads);
+
+    // 流式解码使用的模型
+    const std::shared_ptr<WhisperModel> &streamingModel() const { return draftModel ? draftModel : model; }
+    RecognitionParams(const RecognitionParams &) = delete;
+    RecognitionParams &operator=(const RecognitionParams &) = delete;
+};
+std::shared_ptr<const RecognitionParams> defaultRecognitionParams; // 未发送配置的会话使用
+
+// 流式解码耗时统计，按编码器模式分别累计，用于比较完整编码和分块编码
+struct DecodeStats
+{
+    std::atomic<uint64_t> decodes{0};
+    std::atomic<uint64_t> nanos{0};
+    std::atomic<uint64_t> windowSamples{0};
+    uint64_t loggedDecodes = 0; // 只由调度线程访问
+};
+DecodeStats decodeStats[2]; // 0: 完整编码，1: 分块编码
+
+// 实时结果延迟：调度发现新音频到该次解码的实时结果发出，每个统计周期的样本用于输出 p99
+struct PartialLatencyStats
+{
+    std::mutex mutex;
+    std::vector<uint32_t> millis;
+};
+PartialLatencyStats partialLatency;
+
+// 每个客户端的会话，集中存放该客户端的音频缓冲、识别状态、配置和统计。
+// 客户端连接时创建，客户端断开、剩余音频处理完后销毁；
+// 音频入口、调度和解码直接持有会话指针，不再按客户端ID查表。
+// 识别器内的环形缓冲区由接收线程写入、识别线程读取，互不加锁
+struct Session
+{
+    const std::string clientId;
+    StreamingRecognizer recognizer;
+    std::atomic<bool> busy{false}; // 是否有解码任务正在工作池中执行
+    std::atomic<uint64_t> utteranceEnd{0}; // 最近一次语音结束的绝对样本位置（由接收线程写入）
+    std::shared_ptr<const RecognitionParams> params; // 识别参数，通过 std::atomic_load/atomic_store 访问
+    std::atomic<int> pendingConfigs{0};              // 等待模型加载的配置数（网络线程增加，加载线程减少）
+
+    // 以下仅接收线程（该客户端连接所属的I/O线程）访问
+    VoiceActivityDetector vad;
+    size_t utteranceSamples = 0; // 当前语音段已写入的样本数
+    std::vector<float> vadInput; // 开启语音检测时音频先解码到这里，筛选后再写入环形缓冲区，跨帧复用
+
+    // 以下仅调度线程访问
+    uint64_t lastReceived = 0;                          // 上次调度时累计收到的样本数
+    std::chrono::steady_clock::time_point lastAudioTime; // 最近一次收到新音频的时间
+    bool utteranceOpen = false;                         // 是否有尚未输出结束的语音
+    uint64_t handledEnd = 0;                            // 已处理的语音结束位置
+    std::chrono::steady_clock::time_point lastDecodeTime; // 上次提交流式解码的时间，决定下次解码的截止时间
+
+    // 两遍解码：大模型的整句结果可能乱序完成，按提交顺序发布（由 finalMutex 保护）
+    std::mutex finalMutex;
+    uint64_t nextFinalSequence = 0;                 // 下一个提交的句子序号
+    uint64_t nextPublishSequence = 0;               // 下一个待发布的句子序号
+    std::map<uint64_t, std::string> pendingDrafts;  // 等待最终结果的草稿句子
+    std::map<uint64_t, std::string> finishedFinals; // 已完成、等待前面句子的最终结果
+    std::string livePartial;                        // 草稿模型最近的实时结果
+
+    // 已发布的结果，用于去重（多个解码线程可能同时发布同一会话的结果，由 resultMutex 保护）
+    std::mutex resultMutex;
+    std::string lastPartial;  // 上次发送的实时结果
+    std::string lastComplete; // 上次发送的完整句子
+
+    // 统计，会话结束时输出
+    const std::chrono::steady_clock::time_point createdAt;
+    std::atomic<uint64_t> decodes{0};
+    std::atomic<uint64_t> sentences{0};
+    std::atomic<uint64_t> droppedSamples{0};
+
+    Session(const std::string &id, int sampleRate, size_t bufferSamples)
+        : clientId(id), recognizer(sampleRate, bufferSamples), vad(sampleRate), createdAt(std::chrono::steady_clock::now()) {}
+};
+std::map<std::string, std::shared_ptr<Session>> sessions;
+std::mutex sessionsMutex; // 只保护会话表本身，音频读写不经过这把锁
 const int MAX_AUDIO_LENGTH = 20 * SAMPLE_RATE; // 最大音频长度（10秒）
-// 识别语音相同内容次数
-const int MAX_REPEAT_COUNT = 100;
-std::map<std::string, int> REPEAT_COUNTS;
-std::map<std::string, std::string> REPEAT_TEXTS;
-std::map<std::string, std::string> last_recognized_texts; // 上次识别的文本
-std::map<std::string, std::string> last_complete_texts;   // 上次发送的完整文本
+// 停止收到音频后多久补一次解码，以及多久认为一句话结束
+const std::chrono::milliseconds TAIL_DECODE_DELAY(200);
+const std::chrono::milliseconds UTTERANCE_TIMEOUT(1000);
+// 实时结果的目标刷新间隔：流式解码的截止时间为上次解码后的这一时刻，
+// 工作池过载时实时结果最久未刷新的会话先解码
+const std::chrono::milliseconds PARTIAL_DEADLINE(500);
+
+// 模型加载线程的任务队列：会话配置选择了未加载的模型时，加载和应用配置都在这个线程进行，
+// 网络线程不等待模型文件读取
+std::mutex loaderMutex;
+std::condition_variable loaderCondition;
+std::deque<std::function<void()>> loaderJobs;
+
+// 识别调度线程的唤醒通知：新音频到达或解码完成时置位，多次通知合并为一次调度
+std::mutex scheduleMutex;
+std::condition_variable scheduleCondition;
+bool scheduleSignaled = false;
 
 static const std::regex pattern(R"(。+$)", std::regex::optimize);
 static const std::regex pattern_dian(R"(^\\.)", std::regex::optimize);
@@ -82,19 +185,151 @@ void signalHandler(int signal)
     }
 }
 
+// 唤醒识别调度线程
+void notifyScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(scheduleMutex);
+        scheduleSignaled = true;
+    }
+    scheduleCondition.notify_one();
+}
+
+// 模型加载线程函数：按提交顺序执行加载任务，退出时丢弃未执行的任务
+void modelLoaderLoop()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(loaderMutex);
+            loaderCondition.wait(lock, []
+                                 { return !loaderJobs.empty() || !running; });
+            if (!running)
+            {
+                loaderJobs.clear();
+                break;
+            }
+            job = std::move(loaderJobs.front());
+            loaderJobs.pop_front();
+        }
+        job();
+    }
+}
+
+// 查找客户端会话，客户端未连接或已断开时返回空
+std::shared_ptr<Session> findSession(const std::string &clientId)
+{
+    std::lock_guard<std::mutex> lock(sessionsMutex);
+    auto it = sessions.find(clientId);
+    return it == sessions.end() ? nullptr : it->second;
+}
+
+// 客户端断开，移除会话（接收线程调用，该客户端的音频都已写入）
+// 正在进行的解码持有会话引用，完成后会话随之释放
+void closeSession(const std::shared_ptr<Session> &session)
+{
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex);
+        auto it = sessions.find(session->clientId);
+        if (it != sessions.end() && it->second == session)
+        {
+            sessions.erase(it);
+        }
+    }
+
+    const auto duration = std::chrono::steady_clock::now() - session->createdAt;
+    std::cout << "会话结束 (ClientID: " << session->clientId << "): 时长 "
+              << std::chrono::duration_cast<std::chrono::seconds>(duration).count() << " 秒，音频 "
+              << session->recognizer.receivedSamples() / SAMPLE_RATE << " 秒，解码 " << session->decodes
+              << " 次，输出 " << session->sentences << " 句，丢弃音频 "
+              << session->droppedSamples / (SAMPLE_RATE / 1000) << " 毫秒" << std::endl;
+}
+
+// 取得音频的写入区域（接收线程调用）
+// 不做语音检测时就是会话环形缓冲区的可写区域，音频直接解码进去；否则先写入复用的输入缓冲区
+float *prepareAudio(Session *session, size_t count, size_t &available)
+{
+    if (!vadEnabled)
+    {
+        return session->recognizer.prepareAudio(count, available);
+    }
+    if (session->vadInput.size() < count)
+    {
+        session->vadInput.resize(count);
+    }
+    available = count;
+    return session->vadInput.data();
+}
+
 // Audio data processing callback
-void processAudio(const std::vector<float> &buffer, const std::string &clientId)
+// 提交 prepareAudio 区域中写入的音频，由接收线程调用（会话环形缓冲区的唯一生产者）
+void processAudio(Session *session, size_t length, size_t dropped)
+{
+    bool changed = false;
+
+    // 写入该客户端的环形缓冲区，识别跟不上时丢弃溢出的音频
+    auto append = [&](const float *samples, size_t count)
+    {
+        size_t written = session->recognizer.appendAudio(samples, count);
+        session->utteranceSamples += written;
+        dropped += count - written;
+        changed = true;
+    };
+
+    if (!vadEnabled)
+    {
+        session->recognizer.commitAudio(length);
+        session->utteranceSamples += length;
+        changed = length > 0;
+    }
+    else
+    {
+        // 只有语音段进入识别；语音结束时记录结束位置，调度线程据此立即输出整句
+        session->vad.process(session->vadInput.data(), length, append, [&]()
+                             {
+            // 过短的语音补静音到最短解码长度，保证能被解码
+            if (session->utteranceSamples < (size_t)MIN_AUDIO_SAMPLES)
+            {
+                std::vector<float> padding(MIN_AUDIO_SAMPLES - session->utteranceSamples, 0.0f);
+                append(padding.data(), padding.size());
+            }
+            session->utteranceSamples = 0;
+            session->utteranceEnd = session->recognizer.receivedSamples(); });
+    }
+
+    if (dropped > 0)
+    {
+        session->droppedSamples += dropped;
+        std::cerr << "音频缓冲区已满，丢弃 " << dropped
+                  << " 个样本 (ClientID: " << session->clientId << ")" << std::endl;
+    }
+    if (changed)
+    {
+        notifyScheduler();
+    }
+}
+
+// 客户端连接，创建会话并返回它的音频入口（网络线程调用）
+// 入口持有会话引用，客户端断开、入口释放之前会话不会销毁
+AudioSink openSession(const std::string &clientId)
 {
-    // 使用互斥锁保护队列操作
-    std::lock_guard<std::mutex> lock(audioQueueMutex);
-    if (audioQueue.size() < AUDIO_QUEUE_SIZE)
+    std::shared_ptr<Session> session = std::make_shared<Session>(clientId, SAMPLE_RATE, sessionBufferSamples);
+    session->recognizer.setMaxWindowSamples(MAX_AUDIO_LENGTH);
+    session->params = defaultRecognitionParams;
     {
-        // 将客户端ID与音频数据一起保存
-        AudioData data;
-        data.buffer = buffer;
-        data.clientId = clientId;
-        audioQueue.push(data);
+        std::lock_guard<std::mutex> lock(sessionsMutex);
+        sessions[clientId] = session;
     }
+
+    AudioSink sink;
+    sink.prepare = [session](size_t count, size_t &available)
+    { return prepareAudio(session.get(), count, available); };
+    sink.commit = [session](size_t written, size_t dropped)
+    { processAudio(session.get(), written, dropped); };
+    sink.close = [session]()
+    { closeSession(session); };
+    return sink;
 }
 
 #ifdef _WIN32
@@ -193,349 +428,544 @@ void clearConsole(std::string txt, bool _lines = true)
 #endif
 }
 
-// 语音识别处理线程函数
+// 根据会话配置创建识别参数，config 需在参数使用期间保持有效
+whisper_full_params makeRecognitionParams(const SessionConfig &config, int threads)
+{
+    // 束宽为1时使用贪心解码
+    whisper_full_params wparams = whisper_full_default_params(config.beamSize > 1 ? WHISPER_SAMPLING_BEAM_SEARCH : WHISPER_SAMPLING_GREEDY);
+    wparams.beam_search.beam_size = config.beamSize;
+
+    // 输出控制：关闭实时及进度打印，开启时间戳显示
+    wparams.print_realtime = false;
+    wparams.print_progress = false;
+    wparams.print_timestamps = false;
+
+    // 语言与翻译设置
+    wparams.language = config.language.c_str(); // "auto" 时由模型检测语言
+    wparams.translate = config.translate;
+
+    // 线程设置：每个解码工作线程分到的计算线程数
+    wparams.n_threads = threads;
+
+    // 音频截取设置
+    wparams.offset_ms = 0;   // 从音频起始开始处理
+    wparams.duration_ms = 0; // 0 表示处理整个输入音频
+    wparams.audio_ctx = config.audioCtx; // 减小可降低编码器开销，0 表示模型默认值
+
+    // 输出与 token 限制
+    wparams.max_len = 0;                   // 0 表示不限制输出长度（或采用模型默认值）
+    wparams.max_tokens = config.maxTokens; // 可根据语音内容复杂度适当增加
+
+    // Token 时间戳记录（流式识别依赖token时间戳确定确认边界）
+    wparams.token_timestamps = true;
+    wparams.thold_pt = 0.01f; // 降低时间戳阈值以获取更精确的结果
+
+    // 解码温度及相关阈值设置
+    wparams.temperature = 0.0f;     // 温度设置为0，保证解码的确定性
+    wparams.temperature_inc = 0.0f; // 不进行温度增量调整
+    wparams.entropy_thold = 1.6f;   // 熵阈值，过高可能导致更多噪声输出，过低可能过于保守
+    wparams.logprob_thold = -1.0f;  // 对数概率阈值，控制 token 输出的可靠性
+    wparams.no_speech_thold = 0.6f; // 无语音判定阈值，用于过滤纯背景噪声
+
+    // 解码状态在会话之间共享，不使用状态中保存的上一次解码文本；
+    // 流式识别的上下文由识别器通过 prompt_tokens 传入本会话已确认的文本
+    wparams.no_context = true;
+
+    return wparams;
+}
+
+RecognitionParams::RecognitionParams(std::shared_ptr<WhisperModel> sessionModel, std::shared_ptr<WhisperModel> sessionDraftModel,
+                                     const SessionConfig &sessionConfig, int threads)
+    : model(std::move(sessionModel)),
+      draftModel(std::move(sessionDraftModel)),
+      config(sessionConfig),
+      params(makeRecognitionParams(config, threads)),
+      finalParams(params),
+      chunkedEncoder((config.encoderMode.empty() ? defaultEncoderMode : config.encoderMode) == "chunked")
+{
+    // 整句重新解码不需要token时间戳
+    finalParams.token_timestamps = false;
+}
+
+// 按名称获取模型，name 为空时使用 fallback；未登记或无法加载时返回 false
+bool resolveModel(const std::string &name, const std::string &fallback, std::shared_ptr<WhisperModel> &model)
+{
+    const std::string &modelName = name.empty() ? fallback : name;
+    if (modelName.empty())
+    {
+        model.reset();
+        return true;
+    }
+    if (!modelRegistry->hasModel(modelName))
+    {
+        std::cerr << "未登记的模型: " << modelName << std::endl;
+        return false;
+    }
+    model = modelRegistry->acquire(modelName);
+    return model != nullptr;
+}
+
+// 加载配置使用的模型并应用到会话，模型未加载时会阻塞，只在加载线程或模型都已加载时调用
+bool configureSession(Session &session, const SessionConfig &config)
+{
+    const std::string &clientId = session.clientId;
+    if (config.language != "auto" && whisper_lang_id(config.language.c_str()) < 0)
+    {
+        std::cerr << "不支持的识别语言: " << config.language << " (ClientID: " << clientId << ")" << std::endl;
+        return false;
+    }
+
+    std::shared_ptr<WhisperModel> model = modelRegistry->defaultModel();
+    std::shared_ptr<WhisperModel> draftModel;
+    if (!config.model.empty() && !resolveModel(config.model, "", model))
+    {
+        return false;
+    }
+    if (!resolveModel(config.draftModel, defaultDraftModel, draftModel))
+    {
+        return false;
+    }
+    if (draftModel == model)
+    {
+        draftModel.reset();
+    }
+
+    for (const std::shared_ptr<WhisperModel> &used : {model, draftModel})
+    {
+        if (used && (config.translate || config.language != "en") && !whisper_is_multilingual(used->context()))
+        {
+            std::cerr << "模型 " << used->name() << " 只支持英文识别 (ClientID: " << clientId << ")" << std::endl;
+            return false;
+        }
+    }
+
+    // 新参数从下一次解码开始生效，正在进行的解码继续使用旧参数
+    auto params = std::make_shared<const RecognitionParams>(model, draftModel, config, decoderPool->threadsPerWorker());
+    std::atomic_store(&session.params, params);
+    std::cout << "会话配置已更新 (ClientID: " << clientId << "): 模型=" << model->name()
+              << (draftModel ? " 草稿模型=" + draftModel->name() : std::string())
+              << " 语言=" << config.language << " 束宽=" << config.beamSize << " audio_ctx=" << config.audioCtx
+              << " 编码器=" << (params->chunkedEncoder ? "chunked" : "full") << std::endl;
+    return true;
+}
+
+// 配置使用的模型是否都已加载（未登记的模型不需要加载，应用时直接拒绝）
+bool configModelsLoaded(const SessionConfig &config)
+{
+    for (const std::string &name : {config.model, config.draftModel.empty() ? defaultDraftModel : config.draftModel})
+    {
+        if (!name.empty() && modelRegistry->hasModel(name) && !modelRegistry->isLoaded(name))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 应用客户端发送的会话配置（网络线程调用）
+// 模型都已加载时直接应用；否则交给模型加载线程，加载完成后再应用并调用 done，期间会话继续使用旧配置。
+// 同一会话有配置在等待加载时，之后的配置也排在加载线程中，保证按发送顺序生效
+void applySessionConfig(const SessionConfig &config, const std::string &clientId, std::function<void(bool)> done)
+{
+    std::shared_ptr<Session> session = findSession(clientId);
+    if (!session)
+    {
+        done(false);
+        return;
+    }
+    if (session->pendingConfigs == 0 && configModelsLoaded(config))
+    {
+        done(configureSession(*session, config));
+        return;
+    }
+
+    ++session->pendingConfigs;
+    {
+        std::lock_guard<std::mutex> lock(loaderMutex);
+        loaderJobs.push_back([session, config, done]
+                             {
+            const bool accepted = configureSession(*session, config);
+            --session->pendingConfigs;
+            done(accepted); });
+    }
+    loaderCondition.notify_one();
+}
+
+// 发送完整句子
+void publishCompleteText(Session &session, const std::string &text)
+{
+    std::string sentence = std::regex_replace(text, pattern_dou, "");
+    std::lock_guard<std::mutex> lock(session.resultMutex);
+    if (sentence.empty() || sentence == session.lastComplete)
+    {
+        return;
+    }
+
+    std::cout << "T: " << sentence << std::endl;
+    if (audioServer != nullptr)
+    {
+        audioServer->sendTextResult(sentence, true, session.clientId);
+    }
+    session.lastComplete = sentence;
+    ++session.sentences;
+}
+
+// 发送实时识别结果
+void publishPartialText(Session &session, const std::string &text)
+{
+    // 正则表达式匹配句末句号，去除开头的逗号
+    std::string partial = std::regex_replace(text, pattern, "...");
+    partial = std::regex_replace(partial, pattern_dou, "");
+
+    std::lock_guard<std::mutex> lock(session.resultMutex);
+    if (partial == "." || partial == session.lastPartial)
+    {
+        return;
+    }
+    session.lastPartial = partial;
+    if (partial.empty())
+    {
+        return;
+    }
+
+    // 打印实时识别结果
+    std::cout << "L: " << partial << std::endl;
+    if (audioServer != nullptr)
+    {
+        audioServer->sendTextResult(partial, false, session.clientId);
+    }
+}
+
+// 发送一次增量识别的结果
+void publishRecognitionUpdate(Session &session, const RecognitionUpdate &update)
+{
+    for (const std::string &sentence : update.completed)
+    {
+        publishCompleteText(session, sentence);
+    }
+    publishPartialText(session, update.partial);
+}
+
+// 对一段完整音频解码，返回全部文本
+std::string transcribeSegment(whisper_context *model, whisper_state *state, const whisper_full_params &params, std::vector<float> audio)
+{
+    // whisper 不处理短于1秒的输入，补静音
+    const size_t minSamples = SAMPLE_RATE + SAMPLE_RATE / 10;
+    if (audio.size() < minSamples)
+    {
+        audio.resize(minSamples, 0.0f);
+    }
+    if (whisper_full_with_state(model, state, params, audio.data(), (int)audio.size()) != 0)
+    {
+        return "";
+    }
+
+    std::string text;
+    const int n_segments = whisper_full_n_segments_from_state(state);
+    for (int i = 0; i < n_segments; ++i)
+    {
+        text += whisper_full_get_segment_text_from_state(state, i);
+    }
+    return text;
+}
+
+// 未发布的草稿句子 + 草稿模型的实时结果，调用时需持有 finalMutex
+std::string draftPartial(const Session &session)
+{
+    std::string text;
+    for (const auto &pair : session.pendingDrafts)
+    {
+        text += pair.second;
+    }
+    return text + session.livePartial;
+}
+
+// 一句话的最终结果完成，按顺序发布所有已就绪的句子
+void completeFinalPass(const std::shared_ptr<Session> &session, uint64_t sequence, const std::string &text)
+{
+    std::lock_guard<std::mutex> lock(session->finalMutex);
+    session->finishedFinals[sequence] = text;
+
+    bool published = false;
+    auto it = session->finishedFinals.begin();
+    while (it != session->finishedFinals.end() && it->first == session->nextPublishSequence)
+    {
+        publishCompleteText(*session, it->second);
+        session->pendingDrafts.erase(it->first);
+        it = session->finishedFinals.erase(it);
+        session->nextPublishSequence++;
+        published = true;
+    }
+
+    // 已发布的草稿从实时结果中去掉
+    if (published)
+    {
+        publishPartialText(*session, draftPartial(*session));
+    }
+}
+
+// 把草稿模型确认的一句话交给大模型重新解码，完成前草稿保留在实时结果中
+void submitFinalPass(const std::shared_ptr<Session> &session, const std::shared_ptr<const RecognitionParams> &params, const std::string &draft, std::vector<float> &&audio)
+{
+    uint64_t sequence;
+    {
+        std::lock_guard<std::mutex> lock(session->finalMutex);
+        sequence = session->nextFinalSequence++;
+        session->pendingDrafts[sequence] = draft;
+    }
+
+    auto segment = std::make_shared<std::vector<float>>(std::move(audio));
+    bool submitted = decoderPool->submit(params->model, [session, params, sequence, draft, segment](whisper_context *model, whisper_state *state)
+                                         {
+        // 大模型解码失败时退回草稿结果，保证后面的句子能够发布
+        std::string text;
+        try
+        {
+            if (state != nullptr)
+            {
+                text = transcribeSegment(model, state, params->finalParams, *segment);
+            }
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "整句重新解码出错 (ClientID: " << session->clientId << "): " << e.what() << std::endl;
+        }
+        completeFinalPass(session, sequence, text.empty() ? draft : text); }, DecodePriority::Final);
+    if (!submitted)
+    {
+        completeFinalPass(session, sequence, draft);
+    }
+}
+
+// 发布草稿模型的一次增量结果：确认的句子进入大模型重新解码
+void publishDraftUpdate(const std::shared_ptr<Session> &session, const std::shared_ptr<const RecognitionParams> &params,
+                        RecognitionUpdate &update)
+{
+    for (size_t i = 0; i < update.completed.size(); ++i)
+    {
+        std::vector<float> audio = i < update.completedAudio.size() ? std::move(update.completedAudio[i]) : std::vector<float>();
+        submitFinalPass(session, params, update.completed[i], std::move(audio));
+    }
+
+    std::lock_guard<std::mutex> lock(session->finalMutex);
+    session->livePartial = update.partial;
+    publishPartialText(*session, draftPartial(*session));
+}
+
+// 定期输出流式解码耗时（调度线程调用）
+void logDecodeStats()
+{
+    static std::chrono::steady_clock::time_point lastLog = std::chrono::steady_clock::now();
+    const auto now = std::chrono::steady_clock::now();
+    if (now - lastLog < std::chrono::seconds(10))
+    {
+        return;
+    }
+    lastLog = now;
+
+    static const char *const modes[] = {"完整编码", "分块编码"};
+    for (int i = 0; i < 2; ++i)
+    {
+        DecodeStats &stats = decodeStats[i];
+        const uint64_t decodes = stats.decodes;
+        if (decodes == stats.loggedDecodes)
+        {
+            continue;
+        }
+        stats.loggedDecodes = decodes;
+        std::cout << "流式解码[" << modes[i] << "]: 累计 " << decodes << " 次，平均耗时 "
+                  << stats.nanos / decodes / 1000000 << " 毫秒，平均窗口 "
+                  << std::fixed << std::setprecision(1) << (double)stats.windowSamples / decodes / SAMPLE_RATE << " 秒"
+                  << std::defaultfloat << std::endl;
+    }
+
+    std::vector<uint32_t> latencies;
+    {
+        std::lock_guard<std::mutex> lock(partialLatency.mutex);
+        latencies.swap(partialLatency.millis);
+    }
+    if (!latencies.empty())
+    {
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&latencies](double p)
+        { return latencies[std::min(latencies.size() - 1, (size_t)(latencies.size() * p))]; };
+        std::cout << "实时结果延迟: " << latencies.size() << " 次，p50 " << percentile(0.5)
+                  << " 毫秒，p99 " << percentile(0.99) << " 毫秒，最大 " << latencies.back() << " 毫秒" << std::endl;
+    }
+}
+
+// 语音识别调度线程函数：把有新音频的客户端交给解码工作池
+// 平时阻塞等待通知，只有存在待处理的会话时才按最近的截止时间定时醒来
 void processSpeechRecognition()
 {
+    using Clock = std::chrono::steady_clock;
     while (running)
     {
-        // 获取所有客户端ID的列表
-        std::vector<std::string> clientIds;
+        logDecodeStats();
+
+        // 获取所有会话的快照
+        std::vector<std::shared_ptr<Session>> snapshot;
         {
-            std::lock_guard<std::mutex> lock(userDataMutex);
-            for (const auto &pair : audio_chunks)
+            std::lock_guard<std::mutex> lock(sessionsMutex);
+            snapshot.reserve(sessions.size());
+            for (const auto &entry : sessions)
             {
-                clientIds.push_back(pair.first);
+                snapshot.push_back(entry.second);
             }
         }
 
+        const Clock::time_point now = Clock::now();
+        Clock::time_point nextDeadline = Clock::time_point::max();
+
         // 为每个客户端处理音频
-        for (const std::string &clientId : clientIds)
+        for (std::shared_ptr<Session> &session : snapshot)
         {
-            // 如果是新客户端，初始化相关数据
+            // 上一次解码还在进行，完成时会再次唤醒调度
+            if (session->busy)
             {
-                std::lock_guard<std::mutex> lock(userDataMutex);
-                if (audio_chunk_begins.find(clientId) == audio_chunk_begins.end())
-                {
-                    audio_chunk_begins[clientId] = audio_chunks[clientId].begin();
-                }
-                if (audio_chunk_lasts.find(clientId) == audio_chunk_lasts.end())
-                {
-                    audio_chunk_lasts[clientId] = 0;
-                }
-                if (REPEAT_COUNTS.find(clientId) == REPEAT_COUNTS.end())
-                {
-                    REPEAT_COUNTS[clientId] = 0;
-                }
+                continue;
             }
 
-            // 检查数据是否有变化
-            bool noChange = false;
+            StreamingRecognizer &recognizer = session->recognizer;
+            const uint64_t utteranceEnd = session->utteranceEnd;
+            const bool endPending = utteranceEnd > session->handledEnd;
+            const uint64_t received = recognizer.receivedSamples();
+            if (received != session->lastReceived)
             {
-                std::lock_guard<std::mutex> lock(userDataMutex);
-                noChange = (audio_chunks[clientId].begin() == audio_chunk_begins[clientId] &&
-                            audio_chunks[clientId].size() == audio_chunk_lasts[clientId]);
+                session->lastReceived = received;
+                session->lastAudioTime = now;
+                session->utteranceOpen = true;
+            }
+            if (!session->utteranceOpen)
+            {
+                continue;
             }
 
-            if (noChange)
+            // 新音频足够一步解码时立即解码；不足一步的尾部在语音结束或音频停顿后补一次解码
+            bool decode = recognizer.readyToDecode();
+            if (!decode && recognizer.hasUndecodedAudio())
             {
-                std::lock_guard<std::mutex> lock(userDataMutex);
-                if (REPEAT_COUNTS[clientId] > MAX_REPEAT_COUNT)
+                const Clock::time_point tailDeadline = session->lastAudioTime + TAIL_DECODE_DELAY;
+                if (endPending || now >= tailDeadline)
                 {
-                    REPEAT_COUNTS[clientId] = 0;
-                    if (!last_recognized_texts[clientId].empty())
-                    {
-                        // 将文本发送到WebSocket客户端
-                        if (audioServer != nullptr)
-                        {
-                            audioServer->sendTextResult(
-                                std::regex_replace(last_recognized_texts[clientId], std::regex("\\.\\.\\.$"), "。"),
-                                true,
-                                clientId);
-                        }
-                        last_recognized_texts[clientId] = "";
-                    }
+                    decode = true;
                 }
                 else
                 {
-                    REPEAT_COUNTS[clientId]++;
+                    nextDeadline = std::min(nextDeadline, tailDeadline);
                 }
-                continue;
             }
 
-            // 更新处理状态
+            if (!decode)
             {
-                std::lock_guard<std::mutex> lock(userDataMutex);
-                REPEAT_COUNTS[clientId] = 0;
-                audio_chunk_lasts[clientId] = audio_chunks[clientId].size();
-                audio_chunk_begins[clientId] = audio_chunks[clientId].begin();
-            }
-
-            // 检查是否有足够的样本进行处理
-            bool hasSufficientSamples = false;
-            {
-                std::lock_guard<std::mutex> lock(userDataMutex);
-                hasSufficientSamples = audio_chunks[clientId].size() >= SAMPLE_RATE;
-            }
+                // 检测到语音结束，或长时间没有新音频，认为一句话结束，输出剩余文本
+                const Clock::time_point utteranceDeadline = session->lastAudioTime + UTTERANCE_TIMEOUT;
+                if (!endPending && now < utteranceDeadline)
+                {
+                    nextDeadline = std::min(nextDeadline, utteranceDeadline);
+                    continue;
+                }
+                if (recognizer.hasUndecodedAudio())
+                {
+                    continue;
+                }
 
-            if (hasSufficientSamples)
-            {
-                try
+                // 语音结束之后已到达的音频属于下一句，留在窗口中
+                std::shared_ptr<const RecognitionParams> params = std::atomic_load(&session->params);
+                std::vector<float> audio;
+                std::string text = recognizer.flush(endPending ? utteranceEnd : UINT64_MAX, params->draftModel ? &audio : nullptr);
+                session->handledEnd = utteranceEnd;
+                session->utteranceOpen = recognizer.windowSamples() > 0;
+                if (params->draftModel)
                 {
-                    whisper_full_params wparams = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
-                    // 输出控制：关闭实时及进度打印，开启时间戳显示
-                    wparams.print_realtime = false;
-                    wparams.print_progress = false;
-                    wparams.print_timestamps = false;
-
-                    // 语言与翻译设置
-                    wparams.language = "zh";   // 强制使用中文识别
-                    wparams.translate = false; // 不进行翻译，只转录原语言
-
-                    // 线程设置：采用硬件并发数，加速计算
-                    wparams.n_threads = std::thread::hardware_concurrency();
-
-                    // 音频截取设置
-                    wparams.offset_ms = 0;   // 从音频起始开始处理
-                    wparams.duration_ms = 0; // 0 表示处理整个输入音频
-                    wparams.audio_ctx = 0;   // 保留的音频上下文长度，根据实际使用情况微调
-
-                    // 输出与 token 限制
-                    wparams.max_len = 0;      // 0 表示不限制输出长度（或采用模型默认值）
-                    wparams.max_tokens = 128; // 可根据语音内容复杂度适当增加
-
-                    // Token 时间戳记录
-                    wparams.token_timestamps = true;
-                    wparams.thold_pt = 0.01f; // 降低时间戳阈值以获取更精确的结果
-
-                    // 解码温度及相关阈值设置
-                    wparams.temperature = 0.0f;     // 温度设置为0，保证贪心解码的确定性
-                    wparams.temperature_inc = 0.0f; // 不进行温度增量调整
-                    wparams.entropy_thold = 1.6f;   // 熵阈值，过高可能导致更多噪声输出，过低可能过于保守
-                    wparams.logprob_thold = -1.0f;  // 对数概率阈值，控制 token 输出的可靠性
-                    wparams.no_speech_thold = 0.6f; // 无语音判定阈值，用于过滤纯背景噪声
-
-                    // 上下文保持：适用于连续语音识别场景
-                    wparams.no_context = true;
-
-                    // 获取当前时间戳
-                    auto now = std::chrono::system_clock::now();
-                    auto now_time = std::chrono::system_clock::to_time_t(now);
-                    std::stringstream ss;
-                    ss << std::put_time(std::localtime(&now_time), "%Y-%m-%d-%H-%M-%S");
-                    auto timestamp = ss.str();
-
-                    // 复制音频数据以避免异步访问问题
-                    std::vector<float> audio_copy;
                     {
-                        std::lock_guard<std::mutex> lock(bufferMutex);
-                        audio_copy = audio_chunks[clientId];
+                        std::lock_guard<std::mutex> lock(session->finalMutex);
+                        session->livePartial.clear();
                     }
-
-                    std::string recognized_text;
-                    std::string recognized_text_all;
-                    bool end = false;
-                    float end_time = audio_copy.size() / SAMPLE_RATE * 1000;
-                    std::string last_token;
-
-                    if (whisper_full(ctx, wparams, audio_copy.data(), audio_copy.size()) == 0)
+                    if (!text.empty())
                     {
+                        submitFinalPass(session, params, text, std::move(audio));
+                    }
+                    continue;
+                }
+                if (!text.empty())
+                {
+                    publishCompleteText(*session, text);
+                }
+                std::lock_guard<std::mutex> lock(session->resultMutex);
+                session->lastPartial.clear();
+                continue;
+            }
 
-                        // 提取识别结果
-                        const int n_segments = whisper_full_n_segments(ctx);
-
-                        for (int i = 0; i < n_segments; ++i)
-                        {
-                            // 输出每个token的时间戳信息
-                            std::string str_token_total;
-                            const int n_tokens = whisper_full_n_tokens(ctx, i);
-                            recognized_text = "";
-                            for (int j = 0; j < n_tokens; ++j)
-                            {
-                                const int token = whisper_full_get_token_id(ctx, i, j);
-                                const char *token_text = whisper_token_to_str(ctx, token);
-
-                                // 获取token的时间戳数据
-                                whisper_token_data token_data = whisper_full_get_token_data(ctx, i, j);
-
-                                // 以毫秒为单位输出时间戳
-                                float time_start_ms = token_data.t0 * 10.0f;
-                                float time_end_ms = token_data.t1 * 10.0f;
-
-                                std::string str_token(token_text);
-                                str_token_total += str_token;
-                                last_token = str_token_total;
-                                if (str_token_total.length() > 3)
-                                {
-                                    last_token = str_token_total.substr(str_token_total.length() - 3);
-                                }
-                                if (str_token != "[_BEG_]")
-                                {
-                                    recognized_text += str_token;
-                                }
-                                if (str_token == "." || str_token == "!" || str_token == "?" || str_token == "。" || last_token == "。" || last_token == "？")
-                                {
-                                    end_time = time_end_ms;
-                                    if (j > 2 && j < n_tokens - 10)
-                                    {
-                                        end = true;
-                                    }
-
-                                    break;
-                                }
-                            }
-
-                            const char *text = whisper_full_get_segment_text(ctx, i);
-                            if (text)
-                            {
-                                std::string segment_text(text);
-                                // recognized_text += segment_text;
-                                recognized_text_all = segment_text;
-                            }
-                        }
-
-                        // 正则表达式匹配句末句号
-                        recognized_text_all = std::regex_replace(recognized_text_all, pattern, "...");
-
-                        // 去除开头的逗号
-                        recognized_text = std::regex_replace(recognized_text, pattern_dou, "");
-                        recognized_text_all = std::regex_replace(recognized_text_all, pattern_dou, "");
-
-                        // // 去除句号
-                        // recognized_text = std::regex_replace(recognized_text, pattern_ju, ".");
-                        // recognized_text_all = std::regex_replace(recognized_text_all, pattern_ju, ".");
-
-                        // // 去除感叹号
-                        // recognized_text = std::regex_replace(recognized_text, pattern_gan, "!");
-                        // recognized_text_all = std::regex_replace(recognized_text_all, pattern_gan, "!");
-
-                        // // 去除问号
-                        // recognized_text = std::regex_replace(recognized_text, pattern_wen, "?");
-                        // recognized_text_all = std::regex_replace(recognized_text_all, pattern_wen, "?");
-
-                        // // 去除逗号
-                        // recognized_text = std::regex_replace(recognized_text, pattern_dd, ",");
-                        // recognized_text_all = std::regex_replace(recognized_text_all, pattern_dd, ",");
-
-                        if (recognized_text.empty())
-                        {
-                            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                            continue;
-                        }
-
-                        if (recognized_text_all == ".")
-                        {
-                            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                            continue;
-                        }
-
-                        // 检查是否与上次识别结果相同，避免重复显示
-                        if (recognized_text_all != last_recognized_texts[clientId])
+            // 交给工作池解码，完成前该客户端的识别器只由工作线程读取。
+            // 每个会话同时只有一个解码任务，任务执行时才读取窗口，排队期间到达的音频
+            // 并入同一次解码，不会为过时的音频状态重复解码。
+            // 语音结束后的解码产生最终结果，优先执行；其余按实时结果的截止时间排序
+            session->busy = true;
+            const DecodePriority priority = endPending ? DecodePriority::Final : DecodePriority::Partial;
+            const Clock::time_point deadline = priority == DecodePriority::Final ? Clock::time_point() : session->lastDecodeTime + PARTIAL_DEADLINE;
+            const Clock::time_point audioTime = session->lastAudioTime;
+            session->lastDecodeTime = now;
+            // 两遍解码时由草稿模型解码，并保留确认句子的音频供大模型重新解码
+            std::shared_ptr<const RecognitionParams> params = std::atomic_load(&session->params);
+            recognizer.setCaptureSentenceAudio(params->draftModel != nullptr);
+            recognizer.setEncoderChunkSamples(params->chunkedEncoder ? ENCODER_CHUNK_SAMPLES : 0);
+            recognizer.setMaxPromptTokens((size_t)params->config.promptTokens);
+            bool submitted = decoderPool->submit(params->streamingModel(), [session, params, priority, audioTime](whisper_context *model, whisper_state *state)
+                                                 {
+                try
+                {
+                    RecognitionUpdate update;
+                    const size_t window = session->recognizer.windowSamples();
+                    const auto decodeStart = std::chrono::steady_clock::now();
+                    if (state != nullptr && session->recognizer.decode(model, state, params->params, update))
+                    {
+                        DecodeStats &stats = decodeStats[params->chunkedEncoder ? 1 : 0];
+                        stats.nanos += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - decodeStart).count();
+                        stats.windowSamples += window;
+                        ++stats.decodes;
+                        ++session->decodes;
+                        if (params->draftModel)
                         {
-                            // 打印实时识别结果
-                            std::cout << "L: " << recognized_text_all << std::endl;
-
-                            // 发送文本到WebSocket客户端
-                            if (audioServer != nullptr)
-                            {
-                                audioServer->sendTextResult(recognized_text_all, false, clientId);
-                            }
-
-                            // 更新上次识别结果
-                            last_recognized_texts[clientId] = recognized_text_all;
+                            publishDraftUpdate(session, params, update);
                         }
-
-                        // 如果是完整的句子，则发送完整文本结果
-                        if (end)
+                        else
                         {
-                            // 检查是否与上次完整句子相同，避免重复发送
-                            if (recognized_text != last_complete_texts[clientId])
-                            {
-                                std::cout << "T: " << recognized_text << std::endl;
-
-                                // 发送完整句子到WebSocket客户端
-                                if (audioServer != nullptr)
-                                {
-                                    audioServer->sendTextResult(recognized_text, true, clientId);
-                                }
-
-                                // 更新上次完整句子
-                                last_complete_texts[clientId] = recognized_text;
-                            }
-
-                            {
-                                // 清空音频数据
-                                auto t1 = end_time / 1000 * SAMPLE_RATE;
-
-                                std::lock_guard<std::mutex> lock(bufferMutex);
-                                if (audio_chunks[clientId].size() >= t1)
-                                {
-                                    audio_chunks[clientId].erase(audio_chunks[clientId].begin(), audio_chunks[clientId].begin() + t1);
-                                    std::cout << "<KEYWORD> ClientID: " << clientId << std::endl;
-                                }
-                                else
-                                {
-                                    audio_chunks[clientId].clear();
-                                    std::cout << "<CLEAR> ClientID: " << clientId << std::endl;
-                                }
-
-                                // 重置音频处理状态，避免部分音频被重复处理
-                                audio_chunk_lasts[clientId] = audio_chunks[clientId].size();
-                            }
+                            publishRecognitionUpdate(*session, update);
                         }
-                    }
-
-                    // 限制音频缓冲区大小
-                    std::lock_guard<std::mutex> lock(bufferMutex);
-                    if (audio_chunks[clientId].size() > MAX_AUDIO_LENGTH)
-                    {
-                        if (!last_recognized_texts[clientId].empty())
+                        if (priority == DecodePriority::Partial)
                         {
-                            // 将文本发送到WebSocket客户端
-                            if (audioServer != nullptr)
-                            {
-                                audioServer->sendTextResult(
-                                    std::regex_replace(last_recognized_texts[clientId], std::regex("\\.\\.\\.$"), "。"),
-                                    true,
-                                    clientId);
-                            }
-                            last_recognized_texts[clientId] = "";
+                            const auto latency = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - audioTime);
+                            std::lock_guard<std::mutex> lock(partialLatency.mutex);
+                            partialLatency.millis.push_back((uint32_t)latency.count());
                         }
-                        audio_chunks[clientId].clear();
-                        audio_chunk_begins[clientId] = audio_chunks[clientId].begin();
-                        std::cout << "<TIME> ClientID: " << clientId << std::endl;
                     }
                 }
                 catch (const std::exception &e)
                 {
-                    std::cerr << "处理音频时出错 (ClientID: " << clientId << "): " << e.what() << std::endl;
+                    std::cerr << "处理音频时出错 (ClientID: " << session->clientId << "): " << e.what() << std::endl;
                 }
+                session->busy = false;
+                notifyScheduler(); }, priority, deadline);
+            if (!submitted)
+            {
+                session->busy = false;
             }
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    }
-}
 
-void processAudioStream()
-{
-    while (running)
-    {
-        // 检查队列是否有数据
-        if (!audioQueue.empty())
+        // 等待新音频、解码完成或最近的截止时间
+        std::unique_lock<std::mutex> lock(scheduleMutex);
+        auto woken = []
+        { return scheduleSignaled || !running; };
+        if (nextDeadline == Clock::time_point::max())
         {
-            AudioData data;
-            {
-                std::lock_guard<std::mutex> lock(audioQueueMutex);
-                data = std::move(audioQueue.front());
-                audioQueue.pop();
-            }
-
-            // 添加到音频缓冲区
-            {
-                std::lock_guard<std::mutex> lock(bufferMutex);
-                audio_chunks[data.clientId].insert(audio_chunks[data.clientId].end(), data.buffer.begin(), data.buffer.end());
-            }
+            scheduleCondition.wait(lock, woken);
+        }
+        else
+        {
+            scheduleCondition.wait_until(lock, nextDeadline, woken);
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        scheduleSignaled = false;
     }
 }
 
@@ -565,8 +995,26 @@ int main(int argc, char **argv)
         return 1;
     }
 
-    // 加载模型
+    // 默认模型，同目录下的其他 ggml-*.bin 模型也会被登记，首次使用时加载
     std::string modelPath = "models/ggml-small.bin";
+    size_t modelMemoryMB = 0; // 已加载模型的内存预算（权重加解码状态），0 表示不限制
+
+    // 解码工作池：默认每4个核心一个工作线程，计算线程平均分配
+    int hardwareThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    int decodeWorkers = std::max(1, hardwareThreads / 4);
+    int threadsPerWorker = 0;
+
+    // 客户端发送队列：默认合并未发送的实时结果
+    OutboundQueueOptions queueOptions;
+
+    // 结果消息压缩（客户端支持 permessage-deflate 时启用）
+    DeflateOptions deflateOptions;
+
+    // 分片发送的音频消息默认重组完整后处理
+    bool streamFragments = false;
+
+    // 客户端输入的帧长度、会话积压和总内存上限
+    InputLimits inputLimits;
 
     // 检查命令行参数
     for (int i = 1; i < argc; ++i)
@@ -576,6 +1024,112 @@ int main(int argc, char **argv)
             modelPath = argv[i + 1];
             i++;
         }
+        else if (std::string(argv[i]) == "--workers" && i + 1 < argc)
+        {
+            decodeWorkers = std::max(1, std::atoi(argv[i + 1]));
+            i++;
+        }
+        else if (std::string(argv[i]) == "--threads" && i + 1 < argc)
+        {
+            threadsPerWorker = std::max(1, std::atoi(argv[i + 1]));
+            i++;
+        }
+        else if (std::string(argv[i]) == "--draft-model" && i + 1 < argc)
+        {
+            defaultDraftModel = argv[i + 1];
+            i++;
+        }
+        else if (std::string(argv[i]) == "--model-memory" && i + 1 < argc)
+        {
+            modelMemoryMB = (size_t)std::max(0, std::atoi(argv[i + 1]));
+            i++;
+        }
+        else if (std::string(argv[i]) == "--no-vad")
+        {
+            vadEnabled = false;
+        }
+        else if (std::string(argv[i]) == "--encoder-mode" && i + 1 < argc)
+        {
+            // full: 每次编码完整30秒窗口；chunked: 只编码当前窗口，延迟更低，精度略有下降
+            std::string mode = argv[i + 1];
+            if (mode == "full" || mode == "chunked")
+            {
+                defaultEncoderMode = mode;
+            }
+            else
+            {
+                std::cerr << "未知的编码器模式: " << mode << std::endl;
+            }
+            i++;
+        }
+        else if (std::string(argv[i]) == "--slow-client" && i + 1 < argc)
+        {
+            // drop: 积压时丢弃实时结果；coalesce: 只保留最新实时结果；disconnect: 积压时断开
+            std::string policy = argv[i + 1];
+            if (policy == "drop")
+            {
+                queueOptions.policy = SlowClientPolicy::DropStale;
+            }
+            else if (policy == "coalesce")
+            {
+                queueOptions.policy = SlowClientPolicy::Coalesce;
+            }
+            else if (policy == "disconnect")
+            {
+                queueOptions.policy = SlowClientPolicy::Disconnect;
+            }
+            else
+            {
+                std::cerr << "未知的慢客户端策略: " << policy << std::endl;
+            }
+            i++;
+        }
+        else if (std::string(argv[i]) == "--no-deflate")
+        {
+            deflateOptions.enabled = false;
+        }
+        else if (std::string(argv[i]) == "--deflate-window-bits" && i + 1 < argc)
+        {
+            // 压缩窗口越小，每个连接占用的内存越少，压缩率略低
+            deflateOptions.serverMaxWindowBits = std::min(15, std::max(9, std::atoi(argv[i + 1])));
+            i++;
+        }
+        else if (std::string(argv[i]) == "--stream-fragments")
+        {
+            // 分片的二进制音频消息每到一片就处理，长时间上传不占用重组内存，实时结果更早出现
+            streamFragments = true;
+        }
+        else if (std::string(argv[i]) == "--max-frame-kb" && i + 1 < argc)
+        {
+            inputLimits.maxFrameBytes = (size_t)std::max(1, std::atoi(argv[i + 1])) * 1024;
+            i++;
+        }
+        else if (std::string(argv[i]) == "--max-session-seconds" && i + 1 < argc)
+        {
+            // 识别跟不上时每个会话在识别窗口之外最多积压的音频，决定会话环形缓冲区的大小
+            inputLimits.maxBufferedSeconds = std::max(0.0, std::atof(argv[i + 1]));
+            i++;
+        }
+        else if (std::string(argv[i]) == "--input-memory-mb" && i + 1 < argc)
+        {
+            // 所有连接的输入缓冲总上限，0 表示不限制
+            inputLimits.memoryBudget = (size_t)std::max(0, std::atoi(argv[i + 1])) * 1024 * 1024;
+            i++;
+        }
+        else if (std::string(argv[i]) == "--max-queue-kb" && i + 1 < argc)
+        {
+            queueOptions.maxBytes = (size_t)std::max(16, std::atoi(argv[i + 1])) * 1024;
+            i++;
+        }
+    }
+    audioServer->setOutboundQueueOptions(queueOptions);
+    audioServer->setCompressionOptions(deflateOptions);
+    audioServer->setStreamFragments(streamFragments);
+    audioServer->setInputLimits(inputLimits);
+    sessionBufferSamples = (size_t)MAX_AUDIO_LENGTH + (size_t)(inputLimits.maxBufferedSeconds * SAMPLE_RATE);
+    if (threadsPerWorker == 0)
+    {
+        threadsPerWorker = std::max(1, hardwareThreads / decodeWorkers);
     }
 
     // 检查模型文件是否存在
@@ -585,26 +1139,63 @@ int main(int argc, char **argv)
         return 1;
     }
 
-    std::cout << "加载Whisper模型: " << modelPath << std::endl;
+    // 登记模型并加载默认模型（只加载权重，解码状态在解码时按需创建）
+    modelRegistry = new ModelRegistry(true, modelMemoryMB * 1024 * 1024, decodeWorkers);
+    std::filesystem::path modelDirectory = std::filesystem::path(modelPath).parent_path();
+    modelRegistry->registerDirectory(modelDirectory.empty() ? "." : modelDirectory.string());
+    const std::string defaultModelName = ModelRegistry::modelNameFromPath(modelPath);
+    modelRegistry->registerModel(defaultModelName, modelPath);
+    if (!modelRegistry->setDefaultModel(defaultModelName))
+    {
+        std::cerr << "加载模型失败" << std::endl;
+        delete modelRegistry;
+        return 1;
+    }
+
+    std::cout << "可用模型:";
+    for (const std::string &name : modelRegistry->modelNames())
+    {
+        std::cout << " " << name;
+    }
+    std::cout << "，默认模型: " << defaultModelName << std::endl;
 
-    // 初始化 Whisper 上下文
-    whisper_context_params cparams;
-    cparams.use_gpu = true;
-    ctx = whisper_init_from_file_with_params(modelPath.c_str(), cparams);
+    // 启动解码工作池
+    decoderPool = new DecoderPool();
+    if (!decoderPool->start(decodeWorkers, threadsPerWorker))
+    {
+        std::cerr << "启动解码工作池失败" << std::endl;
+        delete decoderPool;
+        delete modelRegistry;
+        return 1;
+    }
 
-    if (!ctx)
+    // 草稿模型（两遍解码）启动时加载，之后常驻
+    std::shared_ptr<WhisperModel> draftModel;
+    if (!resolveModel(defaultDraftModel, "", draftModel))
     {
-        std::cerr << "加载模型失败" << std::endl;
+        std::cerr << "加载草稿模型失败: " << defaultDraftModel << std::endl;
+        delete decoderPool;
+        delete modelRegistry;
         return 1;
     }
+    if (draftModel == modelRegistry->defaultModel())
+    {
+        draftModel.reset();
+    }
 
-    std::cout << "模型加载成功" << std::endl;
+    // 未发送配置的会话使用默认识别参数；模型就绪后才接受客户端配置
+    defaultRecognitionParams = std::make_shared<const RecognitionParams>(modelRegistry->defaultModel(), draftModel, SessionConfig(), threadsPerWorker);
+    draftModel.reset();
+    audioServer->setConfigCallback(applySessionConfig);
+    audioServer->setConnectCallback(openSession);
 
     // 启动音频处理
-    if (!audioServer->start(processAudio))
+    if (!audioServer->start())
     {
         std::cerr << "启动音频处理失败" << std::endl;
-        whisper_free(ctx);
+        delete decoderPool;
+        defaultRecognitionParams.reset();
+        delete modelRegistry;
         delete audioServer;
         audioServer = nullptr;
         return 1;
@@ -612,12 +1203,9 @@ int main(int argc, char **argv)
 
     std::cout << "开始接收音频数据..." << std::endl;
 
-    // 初始化全局变量
-    audio_chunk_begins[""] = audio_chunks[""].begin();
-
-    // 创建处理线程
-    std::thread processThread(processAudioStream);
+    // 创建识别调度线程和模型加载线程
     std::thread recognitionThread(processSpeechRecognition);
+    std::thread loaderThread(modelLoaderLoop);
 
     // 主线程等待，直到收到退出信号
     while (running)
@@ -625,9 +1213,22 @@ int main(int argc, char **argv)
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
 
-    // 等待线程结束
-    processThread.join();
+    // 唤醒并等待识别调度线程和模型加载线程结束（加载线程会回复客户端，先于音频服务器停止）
+    notifyScheduler();
     recognitionThread.join();
+    {
+        // 持锁通知，加载线程检查 running 之后、进入等待之前不会错过这次通知
+        std::lock_guard<std::mutex> lock(loaderMutex);
+        loaderCondition.notify_all();
+    }
+    loaderThread.join();
+
+    // 停止解码工作池：正在执行的解码和整句重新解码会通过音频服务器发布结果，
+    // 必须在音频服务器停止和释放之前全部结束
+    if (decoderPool)
+    {
+        decoderPool->stop();
+    }
 
     // 清理资源
     if (audioServer)
@@ -637,10 +1238,22 @@ int main(int argc, char **argv)
         audioServer = nullptr;
     }
 
-    if (ctx)
+    // 未执行的解码任务和会话持有模型引用，先于模型注册表释放
+    if (decoderPool)
+    {
+        delete decoderPool;
+        decoderPool = nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex);
+        sessions.clear();
+    }
+    defaultRecognitionParams.reset();
+
+    if (modelRegistry)
     {
-        whisper_free(ctx);
-        ctx = nullptr;
+        delete modelRegistry;
+        modelRegistry = nullptr;
     }
 
     if (systemMonitor)
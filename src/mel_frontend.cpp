@@ -0,0 +1,298 @@
+#include "../include/mel_frontend.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr double PI = 3.14159265358979323846;
+
+    // 静音帧的 log10 能量（whisper 对功率下限取 1e-10）
+    constexpr float SILENCE_LOG = -10.0f;
+
+    // Slaney mel 刻度：1kHz 以下线性，以上对数
+    constexpr double MEL_LINEAR_STEP = 200.0 / 3.0;
+    constexpr double MEL_LOG_START = 1000.0 / MEL_LINEAR_STEP;
+
+    double hzToMel(double hz)
+    {
+        static const double logStep = std::log(6.4) / 27.0;
+        if (hz < 1000.0)
+        {
+            return hz / MEL_LINEAR_STEP;
+        }
+        return MEL_LOG_START + std::log(hz / 1000.0) / logStep;
+    }
+
+    double melToHz(double mel)
+    {
+        static const double logStep = std::log(6.4) / 27.0;
+        if (mel < MEL_LOG_START)
+        {
+            return mel * MEL_LINEAR_STEP;
+        }
+        return 1000.0 * std::exp((mel - MEL_LOG_START) * logStep);
+    }
+}
+
+MelFrontend::MelFrontend(size_t maxSamples)
+    : nMel_(0),
+      capacity_(maxSamples / HOP_LENGTH + 2),
+      origin_(0),
+      endFrame_(0)
+{
+    hann_.resize(N_FFT);
+    cos_.resize(N_FFT);
+    sin_.resize(N_FFT);
+    for (int i = 0; i < N_FFT; ++i)
+    {
+        hann_[i] = (float)(0.5 * (1.0 - std::cos(2.0 * PI * i / N_FFT)));
+        cos_[i] = (float)std::cos(2.0 * PI * i / N_FFT);
+        sin_[i] = (float)std::sin(2.0 * PI * i / N_FFT);
+    }
+    frameBuffer_.resize(N_FFT);
+    fftIn_.resize(N_FFT * 2);
+    fftOut_.resize(N_FFT * 8);
+}
+
+void MelFrontend::reset()
+{
+    origin_ = 0;
+    endFrame_ = 0;
+}
+
+void MelFrontend::buildFilters(int nMel)
+{
+    nMel_ = nMel;
+    frames_.assign(capacity_ * nMel_, 0.0f);
+    tail_.resize((size_t)nMel_ * 4);
+    filters_.clear();
+    filterBegin_.assign(nMel_, 0);
+    filterLength_.assign(nMel_, 0);
+    filterOffset_.assign(nMel_, 0);
+
+    // 与 librosa.filters.mel(sr=16000, n_fft=400, n_mels=nMel) 相同：三角滤波器，按带宽归一化
+    const int bins = N_FFT / 2 + 1;
+    const double melMax = hzToMel(SAMPLE_RATE / 2.0);
+    std::vector<double> points(nMel_ + 2);
+    for (int i = 0; i < nMel_ + 2; ++i)
+    {
+        points[i] = melToHz(melMax * i / (nMel_ + 1));
+    }
+    for (int m = 0; m < nMel_; ++m)
+    {
+        const double lower = points[m];
+        const double center = points[m + 1];
+        const double upper = points[m + 2];
+        const double norm = 2.0 / (upper - lower);
+        filterOffset_[m] = filters_.size();
+        filterBegin_[m] = -1;
+        for (int b = 0; b < bins; ++b)
+        {
+            const double hz = (double)b * SAMPLE_RATE / N_FFT;
+            const double weight = std::max(0.0, std::min((hz - lower) / (center - lower), (upper - hz) / (upper - center)));
+            if (weight <= 0.0)
+            {
+                if (filterBegin_[m] >= 0)
+                {
+                    break;
+                }
+                continue;
+            }
+            if (filterBegin_[m] < 0)
+            {
+                filterBegin_[m] = b;
+            }
+            filters_.push_back((float)(weight * norm));
+            ++filterLength_[m];
+        }
+        filterBegin_[m] = std::max(filterBegin_[m], 0);
+    }
+}
+
+int MelFrontend::compute(const float *samples, uint64_t start, size_t count, int nMel, int paddingFrames,
+                         std::vector<float> &mel, int &nLen)
+{
+    nLen = 0;
+    if (count < (size_t)N_FFT || count / HOP_LENGTH + 2 > capacity_ || nMel <= 0)
+    {
+        return 0;
+    }
+    if (nMel != nMel_)
+    {
+        buildFilters(nMel);
+        reset();
+    }
+
+    // 帧 k 的中心在 origin_ + k * HOP_LENGTH，覆盖中心前后各 N_FFT/2 个样本。
+    // 窗口起点不在帧网格上，或者开头两帧需要的音频已被丢弃且未缓存时，以窗口起点重建网格
+    uint64_t base = 0;
+    bool rebuild = endFrame_ == 0 || start < origin_ || (start - origin_) % HOP_LENGTH != 0;
+    if (!rebuild)
+    {
+        base = (start - origin_) / HOP_LENGTH;
+        rebuild = start != origin_ && endFrame_ < base + 2;
+    }
+    if (rebuild)
+    {
+        origin_ = start;
+        endFrame_ = 0;
+        base = 0;
+    }
+    endFrame_ = std::max(endFrame_, base);
+
+    // 窗口完全落在音频内的帧（whisper 的 n_len_org）不会再变化，缓存起来；
+    // 之后跨越音频末尾的帧按补零计算，不缓存
+    const int finalFrames = 1 + (int)((count - N_FFT / 2) / HOP_LENGTH);
+    const int audioFrames = (int)(count / HOP_LENGTH) + 1;
+    for (uint64_t k = endFrame_; k < base + finalFrames; ++k)
+    {
+        computeFrame(samples, start, count, k, frameAt(k));
+    }
+    endFrame_ = std::max(endFrame_, base + finalFrames);
+    for (int i = finalFrames; i < audioFrames; ++i)
+    {
+        computeFrame(samples, start, count, base + i, tail_.data() + (size_t)(i - finalFrames) * nMel_);
+    }
+    auto frame = [&](int i) -> const float *
+    {
+        return i < finalFrames ? frameAt(base + i) : tail_.data() + (size_t)(i - finalFrames) * nMel_;
+    };
+
+    // 与 whisper 相同的归一化：最大值以下 8（即80dB）截断，再缩放到约 [-1, 1]
+    float maxLog = SILENCE_LOG;
+    for (int i = 0; i < audioFrames; ++i)
+    {
+        const float *values = frame(i);
+        for (int j = 0; j < nMel_; ++j)
+        {
+            maxLog = std::max(maxLog, values[j]);
+        }
+    }
+    const float floorLog = maxLog - 8.0f;
+
+    nLen = audioFrames + std::max(paddingFrames, 1) - 1;
+    mel.resize((size_t)nMel_ * nLen);
+    const float silence = (std::max(SILENCE_LOG, floorLog) + 4.0f) / 4.0f;
+    for (int i = 0; i < audioFrames; ++i)
+    {
+        const float *values = frame(i);
+        for (int j = 0; j < nMel_; ++j)
+        {
+            mel[(size_t)j * nLen + i] = (std::max(values[j], floorLog) + 4.0f) / 4.0f;
+        }
+    }
+    for (int j = 0; j < nMel_; ++j)
+    {
+        std::fill(mel.begin() + (size_t)j * nLen + audioFrames, mel.begin() + (size_t)(j + 1) * nLen, silence);
+    }
+    return finalFrames;
+}
+
+void MelFrontend::computeFrame(const float *samples, uint64_t start, size_t count, uint64_t index, float *out)
+{
+    // 帧第一个样本相对窗口起点的位置；网格起点之前按 whisper 的方式镜像填充
+    const int64_t offset = (int64_t)(origin_ + index * HOP_LENGTH) - N_FFT / 2 - (int64_t)start;
+    const float *frame = frameBuffer_.data();
+    if (offset >= 0 && offset + N_FFT <= (int64_t)count)
+    {
+        frame = samples + offset;
+    }
+    else
+    {
+        for (int i = 0; i < N_FFT; ++i)
+        {
+            const int64_t pos = offset + i;
+            if (pos < 0)
+            {
+                frameBuffer_[i] = -pos < (int64_t)count ? samples[-pos] : 0.0f;
+            }
+            else
+            {
+                frameBuffer_[i] = pos < (int64_t)count ? samples[pos] : 0.0f;
+            }
+        }
+    }
+
+    for (int i = 0; i < N_FFT; ++i)
+    {
+        fftIn_[i] = frame[i] * hann_[i];
+    }
+    fft(fftIn_.data(), N_FFT, fftOut_.data());
+
+    // 功率谱，结果放回 fftOut_ 的前半部分
+    float *power = fftOut_.data();
+    for (int b = 0; b <= N_FFT / 2; ++b)
+    {
+        power[b] = fftOut_[2 * b] * fftOut_[2 * b] + fftOut_[2 * b + 1] * fftOut_[2 * b + 1];
+    }
+
+    for (int m = 0; m < nMel_; ++m)
+    {
+        const float *weights = filters_.data() + filterOffset_[m];
+        const float *bins = power + filterBegin_[m];
+        double sum = 0.0;
+        for (int b = 0; b < filterLength_[m]; ++b)
+        {
+            sum += bins[b] * weights[b];
+        }
+        out[m] = (float)std::log10(std::max(sum, 1e-10));
+    }
+}
+
+void MelFrontend::fft(float *in, int n, float *out) const
+{
+    if (n == 1)
+    {
+        out[0] = in[0];
+        out[1] = 0.0f;
+        return;
+    }
+
+    const int step = N_FFT / n;
+    if (n % 2 == 1)
+    {
+        for (int k = 0; k < n; ++k)
+        {
+            float re = 0.0f;
+            float im = 0.0f;
+            for (int t = 0; t < n; ++t)
+            {
+                const int index = (k * t % n) * step;
+                re += in[t] * cos_[index];
+                im -= in[t] * sin_[index];
+            }
+            out[2 * k] = re;
+            out[2 * k + 1] = im;
+        }
+        return;
+    }
+
+    const int half = n / 2;
+    float *even = in + n;
+    for (int i = 0; i < half; ++i)
+    {
+        even[i] = in[2 * i];
+    }
+    float *evenFft = out + 2 * n;
+    fft(even, half, evenFft);
+
+    float *odd = even;
+    for (int i = 0; i < half; ++i)
+    {
+        odd[i] = in[2 * i + 1];
+    }
+    float *oddFft = evenFft + n;
+    fft(odd, half, oddFft);
+
+    for (int k = 0; k < half; ++k)
+    {
+        const float re = cos_[k * step];
+        const float im = -sin_[k * step];
+        const float oddRe = oddFft[2 * k] * re - oddFft[2 * k + 1] * im;
+        const float oddIm = oddFft[2 * k] * im + oddFft[2 * k + 1] * re;
+        out[2 * k] = evenFft[2 * k] + oddRe;
+        out[2 * k + 1] = evenFft[2 * k + 1] + oddIm;
+        out[2 * (k + half)] = evenFft[2 * k] - oddRe;
+        out[2 * (k + half) + 1] = evenFft[2 * k + 1] - oddIm;
+    }
+}
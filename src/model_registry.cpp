@@ -0,0 +1,281 @@
+#include "../include/model_registry.h"
+#include "../whisper.cpp/include/whisper.h"
+#include <iostream>
+#include <filesystem>
+#include <algorithm>
+
+WhisperModel::WhisperModel(const std::string &name, whisper_context *ctx, size_t memoryBytes)
+    : name_(name), ctx_(ctx), memoryBytes_(memoryBytes)
+{
+}
+
+WhisperModel::~WhisperModel()
+{
+    // 解码状态依赖模型，先于模型释放
+    for (whisper_state *state : allStates_)
+    {
+        whisper_free_state(state);
+    }
+    if (ctx_)
+    {
+        whisper_free(ctx_);
+    }
+    std::cout << "模型已卸载: " << name_ << std::endl;
+}
+
+whisper_state *WhisperModel::acquireState()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!freeStates_.empty())
+        {
+            whisper_state *state = freeStates_.back();
+            freeStates_.pop_back();
+            return state;
+        }
+    }
+
+    whisper_state *state = whisper_init_state(ctx_);
+    if (state == nullptr)
+    {
+        std::cerr << "创建解码状态失败 (模型: " << name_ << ")" << std::endl;
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    allStates_.push_back(state);
+    return state;
+}
+
+void WhisperModel::releaseState(whisper_state *state)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    freeStates_.push_back(state);
+}
+
+ModelRegistry::ModelRegistry(bool useGpu, size_t memoryBudget, int statesPerModel)
+    : useGpu_(useGpu), memoryBudget_(memoryBudget), statesPerModel_((size_t)std::max(1, statesPerModel)), loadedBytes_(0), useCounter_(0)
+{
+}
+
+ModelRegistry::~ModelRegistry()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    defaultModel_.reset();
+    entries_.clear();
+}
+
+std::string ModelRegistry::modelNameFromPath(const std::string &path)
+{
+    std::string name = std::filesystem::path(path).stem().string();
+    if (name.rfind("ggml-", 0) == 0)
+    {
+        name = name.substr(5);
+    }
+    return name;
+}
+
+size_t ModelRegistry::estimateStateBytes(whisper_context *ctx)
+{
+    // 与 whisper.cpp 的 whisper_init_state 对应：
+    // 自注意力和交叉注意力的 KV 缓存（F16，长度按 256 对齐），
+    // 编码器计算缓冲（约为音频上下文激活的 16 倍），解码器计算缓冲（每个文本位置一行 F32 logits）
+    auto pad = [](size_t n)
+    { return (n + 255) / 256 * 256; };
+    const size_t textState = (size_t)whisper_model_n_text_state(ctx);
+    const size_t textLayers = (size_t)whisper_model_n_text_layer(ctx);
+    const size_t textCtx = (size_t)whisper_model_n_text_ctx(ctx);
+    const size_t audioCtx = (size_t)whisper_model_n_audio_ctx(ctx);
+    const size_t audioState = (size_t)whisper_model_n_audio_state(ctx);
+    const size_t vocab = (size_t)whisper_model_n_vocab(ctx);
+
+    const size_t kvSelf = 2 * textLayers * pad(textCtx) * textState * sizeof(uint16_t);
+    const size_t kvCross = 2 * textLayers * pad(audioCtx) * textState * sizeof(uint16_t);
+    const size_t encoder = 16 * audioCtx * audioState * sizeof(float);
+    const size_t decoder = textCtx * vocab * sizeof(float);
+    return kvSelf + kvCross + encoder + decoder;
+}
+
+void ModelRegistry::registerModel(const std::string &name, const std::string &path)
+{
+    std::error_code ec;
+    size_t fileSize = (size_t)std::filesystem::file_size(path, ec);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry &entry = entries_[name];
+    if (entry.model)
+    {
+        return;
+    }
+    entry.path = path;
+    entry.fileSize = ec ? 0 : fileSize;
+}
+
+int ModelRegistry::registerDirectory(const std::string &directory)
+{
+    int count = 0;
+    std::error_code ec;
+    for (const auto &file : std::filesystem::directory_iterator(directory, ec))
+    {
+        const std::string filename = file.path().filename().string();
+        if (file.is_regular_file() && filename.rfind("ggml-", 0) == 0 && file.path().extension() == ".bin")
+        {
+            registerModel(modelNameFromPath(filename), file.path().string());
+            ++count;
+        }
+    }
+    return count;
+}
+
+bool ModelRegistry::hasModel(const std::string &name) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.count(name) > 0;
+}
+
+std::vector<std::string> ModelRegistry::modelNames() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> names;
+    for (const auto &pair : entries_)
+    {
+        names.push_back(pair.first);
+    }
+    return names;
+}
+
+bool ModelRegistry::isLoaded(const std::string &name) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(name);
+    return it != entries_.end() && it->second.model != nullptr;
+}
+
+std::shared_ptr<WhisperModel> ModelRegistry::acquire(const std::string &name)
+{
+    std::string path;
+    size_t fileSize = 0;
+    std::promise<std::shared_ptr<WhisperModel>> loaded;
+    std::shared_future<std::shared_ptr<WhisperModel>> inFlight;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(name);
+        if (it == entries_.end())
+        {
+            return nullptr;
+        }
+        Entry &entry = it->second;
+        entry.lastUsed = ++useCounter_;
+        if (entry.model)
+        {
+            return entry.model;
+        }
+        if (entry.loading.valid())
+        {
+            // 其他线程正在加载同一个模型，等待它的结果
+            inFlight = entry.loading;
+        }
+        else
+        {
+            path = entry.path;
+            fileSize = entry.fileSize;
+
+            // 先腾出空间，放不下时不加载
+            if (!makeRoom(fileSize))
+            {
+                std::cerr << "内存预算不足，无法加载模型: " << name << std::endl;
+                return nullptr;
+            }
+            entry.loading = loaded.get_future().share();
+        }
+    }
+    if (inFlight.valid())
+    {
+        return inFlight.get();
+    }
+
+    // 加载耗时较长，不持有锁
+    std::cout << "加载Whisper模型: " << name << " (" << path << ")" << std::endl;
+    whisper_context_params cparams = whisper_context_default_params();
+    cparams.use_gpu = useGpu_;
+    whisper_context *ctx = whisper_init_from_file_with_params_no_state(path.c_str(), cparams);
+    std::shared_ptr<WhisperModel> model;
+    size_t memoryBytes = fileSize;
+    if (ctx)
+    {
+        // 权重加载之后才知道超参数，解码状态的预算在这里补上
+        memoryBytes += statesPerModel_ * estimateStateBytes(ctx);
+        model = std::make_shared<WhisperModel>(name, ctx, memoryBytes);
+    }
+    else
+    {
+        std::cerr << "加载模型失败: " << path << std::endl;
+    }
+
+    std::shared_ptr<WhisperModel> result;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Entry &entry = entries_[name];
+        entry.loading = std::shared_future<std::shared_ptr<WhisperModel>>();
+        if (model && !makeRoom(memoryBytes))
+        {
+            std::cerr << "内存预算不足，无法加载模型: " << name << std::endl;
+        }
+        else if (model)
+        {
+            entry.model = model;
+            result = model;
+            loadedBytes_ += memoryBytes;
+            std::cout << "模型加载成功: " << name << "，已加载模型占用 " << loadedBytes_ / (1024 * 1024) << " MB" << std::endl;
+        }
+    }
+    loaded.set_value(result);
+    return result;
+}
+
+bool ModelRegistry::makeRoom(size_t required)
+{
+    if (memoryBudget_ == 0)
+    {
+        return true;
+    }
+
+    while (loadedBytes_ + required > memoryBudget_)
+    {
+        // 只有注册表自己持有引用的模型是空闲的
+        Entry *victim = nullptr;
+        for (auto &pair : entries_)
+        {
+            Entry &entry = pair.second;
+            if (entry.model && entry.model.use_count() == 1 &&
+                (victim == nullptr || entry.lastUsed < victim->lastUsed))
+            {
+                victim = &entry;
+            }
+        }
+        if (victim == nullptr)
+        {
+            return false;
+        }
+        loadedBytes_ -= victim->model->memoryBytes();
+        victim->model.reset();
+    }
+    return true;
+}
+
+bool ModelRegistry::setDefaultModel(const std::string &name)
+{
+    std::shared_ptr<WhisperModel> model = acquire(name);
+    if (!model)
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    defaultModel_ = model;
+    return true;
+}
+
+std::shared_ptr<WhisperModel> ModelRegistry::defaultModel() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return defaultModel_;
+}
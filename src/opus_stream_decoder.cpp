@@ -0,0 +1,113 @@
+#include "../include/opus_stream_decoder.h"
+#include <algorithm>
+
+#ifdef USE_OPUS
+#include <opus.h>
+#endif
+
+namespace
+{
+    // 单个Opus包最长120毫秒
+    constexpr int MAX_PACKET_SAMPLES = OpusStreamDecoder::OUTPUT_SAMPLE_RATE * 120 / 1000;
+
+    // 连续丢包超过此数量时不再补偿，直接跳过
+    constexpr size_t MAX_CONCEALED_PACKETS = 5;
+}
+
+#ifdef USE_OPUS
+
+OpusStreamDecoder::OpusStreamDecoder()
+    : decoder_(nullptr),
+      lastPacketSamples_(OUTPUT_SAMPLE_RATE / 50)
+{
+    int error = OPUS_OK;
+    decoder_ = opus_decoder_create(OUTPUT_SAMPLE_RATE, 1, &error);
+    if (error != OPUS_OK)
+    {
+        decoder_ = nullptr;
+    }
+}
+
+OpusStreamDecoder::~OpusStreamDecoder()
+{
+    if (decoder_)
+    {
+        opus_decoder_destroy(decoder_);
+    }
+}
+
+bool OpusStreamDecoder::supported()
+{
+    return true;
+}
+
+int OpusStreamDecoder::decode(const uint8_t *packet, size_t size, std::vector<float> &out)
+{
+    if (!decoder_ || size == 0)
+    {
+        return -1;
+    }
+
+    // 直接解码到输出缓冲区的末尾
+    const size_t offset = out.size();
+    out.resize(offset + MAX_PACKET_SAMPLES);
+    int samples = opus_decode_float(decoder_, packet, (opus_int32)size, out.data() + offset, MAX_PACKET_SAMPLES, 0);
+    out.resize(offset + std::max(samples, 0));
+    if (samples > 0)
+    {
+        lastPacketSamples_ = samples;
+    }
+    return samples < 0 ? -1 : samples;
+}
+
+int OpusStreamDecoder::conceal(size_t lostPackets, std::vector<float> &out)
+{
+    if (!decoder_ || lostPackets == 0 || lostPackets > MAX_CONCEALED_PACKETS)
+    {
+        return 0;
+    }
+
+    int total = 0;
+    for (size_t i = 0; i < lostPackets; ++i)
+    {
+        const size_t offset = out.size();
+        out.resize(offset + lastPacketSamples_);
+        int samples = opus_decode_float(decoder_, nullptr, 0, out.data() + offset, lastPacketSamples_, 0);
+        out.resize(offset + std::max(samples, 0));
+        if (samples <= 0)
+        {
+            break;
+        }
+        total += samples;
+    }
+    return total;
+}
+
+#else
+
+OpusStreamDecoder::OpusStreamDecoder()
+    : decoder_(nullptr),
+      lastPacketSamples_(0)
+{
+}
+
+OpusStreamDecoder::~OpusStreamDecoder()
+{
+}
+
+bool OpusStreamDecoder::supported()
+{
+    return false;
+}
+
+int OpusStreamDecoder::decode(const uint8_t *, size_t, std::vector<float> &)
+{
+    return -1;
+}
+
+int OpusStreamDecoder::conceal(size_t, std::vector<float> &)
+{
+    return 0;
+}
+
+#endif
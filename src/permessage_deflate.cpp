@@ -0,0 +1,284 @@
+#include "../include/permessage_deflate.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace
+{
+    // 每条压缩消息末尾被省略的同步刷新标记
+    const uint8_t SYNC_TAIL[4] = {0x00, 0x00, 0xFF, 0xFF};
+
+    std::string trim(const std::string& s)
+    {
+        size_t begin = s.find_first_not_of(" \t");
+        if (begin == std::string::npos) {
+            return "";
+        }
+        size_t end = s.find_last_not_of(" \t");
+        return s.substr(begin, end - begin + 1);
+    }
+
+    std::vector<std::string> split(const std::string& s, char separator)
+    {
+        std::vector<std::string> parts;
+        size_t start = 0;
+        while (true) {
+            size_t pos = s.find(separator, start);
+            parts.push_back(trim(s.substr(start, pos == std::string::npos ? std::string::npos : pos - start)));
+            if (pos == std::string::npos) {
+                return parts;
+            }
+            start = pos + 1;
+        }
+    }
+
+    // 解析窗口位数（8-15），值可以带引号
+    bool parseWindowBits(std::string value, int& bits)
+    {
+        if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+            value = value.substr(1, value.size() - 2);
+        }
+        if (value.empty() || value.size() > 2 || !std::all_of(value.begin(), value.end(), ::isdigit)) {
+            return false;
+        }
+        bits = std::atoi(value.c_str());
+        return bits >= 8 && bits <= 15;
+    }
+
+    // 尝试接受一个提议
+    bool acceptOffer(const std::vector<std::string>& parameters, const DeflateOptions& options,
+                     DeflateParams& params, std::string& response)
+    {
+        bool serverNoContextTakeover = options.serverNoContextTakeover;
+        bool clientNoContextTakeover = false;
+        int serverBits = options.serverMaxWindowBits;
+        bool clientBitsOffered = false;
+        int clientBitsLimit = 15;
+
+        for (size_t i = 1; i < parameters.size(); ++i) {
+            std::string name = parameters[i];
+            std::string value;
+            bool hasValue = false;
+            size_t eq = name.find('=');
+            if (eq != std::string::npos) {
+                value = trim(name.substr(eq + 1));
+                name = trim(name.substr(0, eq));
+                hasValue = true;
+            }
+
+            if (name == "server_no_context_takeover" && !hasValue) {
+                serverNoContextTakeover = true;
+            } else if (name == "client_no_context_takeover" && !hasValue) {
+                clientNoContextTakeover = true;
+            } else if (name == "server_max_window_bits" && hasValue) {
+                int bits;
+                if (!parseWindowBits(value, bits)) {
+                    return false;
+                }
+                serverBits = std::min(serverBits, bits);
+            } else if (name == "client_max_window_bits") {
+                clientBitsOffered = true;
+                if (hasValue && !parseWindowBits(value, clientBitsLimit)) {
+                    return false;
+                }
+            } else {
+                // 未知或格式错误的参数，拒绝这个提议
+                return false;
+            }
+        }
+
+        // zlib的原始deflate流不支持8位窗口
+        if (serverBits < 9) {
+            return false;
+        }
+
+        params.serverNoContextTakeover = serverNoContextTakeover;
+        params.clientNoContextTakeover = clientNoContextTakeover;
+        params.serverMaxWindowBits = serverBits;
+        // 客户端未声明支持 client_max_window_bits 时只能按15位窗口解压
+        params.clientMaxWindowBits = clientBitsOffered ? std::max(9, std::min(clientBitsLimit, options.clientMaxWindowBits)) : 15;
+
+        response = "permessage-deflate";
+        if (serverNoContextTakeover) {
+            response += "; server_no_context_takeover";
+        }
+        if (clientNoContextTakeover) {
+            response += "; client_no_context_takeover";
+        }
+        if (serverBits < 15) {
+            response += "; server_max_window_bits=" + std::to_string(serverBits);
+        }
+        if (clientBitsOffered && params.clientMaxWindowBits < 15) {
+            response += "; client_max_window_bits=" + std::to_string(params.clientMaxWindowBits);
+        }
+        return true;
+    }
+}
+
+bool deflateSupported()
+{
+#ifdef USE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool negotiatePerMessageDeflate(const std::string& offers, const DeflateOptions& options,
+                                DeflateParams& params, std::string& response)
+{
+    if (!deflateSupported() || !options.enabled) {
+        return false;
+    }
+
+    // 按客户端的偏好顺序取第一个能满足的提议
+    for (const std::string& offer : split(offers, ',')) {
+        std::vector<std::string> parameters = split(offer, ';');
+        if (parameters[0] == "permessage-deflate" && acceptOffer(parameters, options, params, response)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#ifdef USE_ZLIB
+
+struct PerMessageDeflate::Streams {
+    z_stream deflater;
+    z_stream inflater;
+    bool deflaterReady = false;
+    bool inflaterReady = false;
+};
+
+PerMessageDeflate::PerMessageDeflate(const DeflateParams& params, const DeflateOptions& options)
+    : streams_(new Streams()), params_(params), minCompressSize_(options.minCompressSize)
+{
+    memset(&streams_->deflater, 0, sizeof(z_stream));
+    memset(&streams_->inflater, 0, sizeof(z_stream));
+    // 负的窗口位数表示不带zlib头的原始deflate流
+    streams_->deflaterReady = deflateInit2(&streams_->deflater, options.compressionLevel, Z_DEFLATED,
+                                           -params.serverMaxWindowBits, options.memLevel, Z_DEFAULT_STRATEGY) == Z_OK;
+    streams_->inflaterReady = inflateInit2(&streams_->inflater, -params.clientMaxWindowBits) == Z_OK;
+}
+
+PerMessageDeflate::~PerMessageDeflate()
+{
+    if (streams_->deflaterReady) {
+        deflateEnd(&streams_->deflater);
+    }
+    if (streams_->inflaterReady) {
+        inflateEnd(&streams_->inflater);
+    }
+}
+
+bool PerMessageDeflate::valid() const
+{
+    return streams_->deflaterReady && streams_->inflaterReady;
+}
+
+bool PerMessageDeflate::compress(const uint8_t* data, size_t length, std::vector<uint8_t>& out)
+{
+    z_stream& zs = streams_->deflater;
+    size_t start = out.size();
+    zs.next_in = (Bytef*)data;
+    zs.avail_in = (uInt)length;
+
+    // 同步刷新后输出以 00 00 FF FF 结尾，发送时去掉
+    do {
+        size_t offset = out.size();
+        size_t chunk = std::max<size_t>(deflateBound(&zs, zs.avail_in), 64);
+        out.resize(offset + chunk);
+        zs.next_out = out.data() + offset;
+        zs.avail_out = (uInt)chunk;
+        int result = deflate(&zs, Z_SYNC_FLUSH);
+        out.resize(out.size() - zs.avail_out);
+        if (result != Z_OK && result != Z_BUF_ERROR) {
+            out.resize(start);
+            return false;
+        }
+    } while (zs.avail_out == 0);
+
+    if (out.size() - start >= 4 && memcmp(out.data() + out.size() - 4, SYNC_TAIL, 4) == 0) {
+        out.resize(out.size() - 4);
+    }
+    if (params_.serverNoContextTakeover) {
+        deflateReset(&zs);
+    }
+    return true;
+}
+
+bool PerMessageDeflate::decompress(const uint8_t* data, size_t length, std::vector<uint8_t>& out, size_t maxSize)
+{
+    z_stream& zs = streams_->inflater;
+    out.clear();
+
+    // 补回发送方省略的同步刷新标记
+    const uint8_t* inputs[2] = {data, SYNC_TAIL};
+    const size_t lengths[2] = {length, sizeof(SYNC_TAIL)};
+    for (int part = 0; part < 2; ++part) {
+        zs.next_in = (Bytef*)inputs[part];
+        zs.avail_in = (uInt)lengths[part];
+        do {
+            size_t offset = out.size();
+            size_t chunk = std::max<size_t>(lengths[part] * 2, 4096);
+            out.resize(offset + chunk);
+            zs.next_out = out.data() + offset;
+            zs.avail_out = (uInt)chunk;
+            int result = inflate(&zs, Z_SYNC_FLUSH);
+            out.resize(out.size() - zs.avail_out);
+            if (out.size() > maxSize || (result != Z_OK && result != Z_BUF_ERROR && result != Z_STREAM_END)) {
+                inflateReset(&zs);
+                return false;
+            }
+            if (result == Z_STREAM_END) {
+                // 客户端用了最终块结束消息，之后的数据（补回的标记）不再需要
+                inflateReset(&zs);
+                return true;
+            }
+            if (result == Z_BUF_ERROR && zs.avail_out > 0) {
+                break;
+            }
+        } while (zs.avail_in > 0 || zs.avail_out == 0);
+    }
+
+    if (params_.clientNoContextTakeover) {
+        inflateReset(&zs);
+    }
+    return true;
+}
+
+#else
+
+struct PerMessageDeflate::Streams {
+};
+
+PerMessageDeflate::PerMessageDeflate(const DeflateParams& params, const DeflateOptions& options)
+    : params_(params), minCompressSize_(options.minCompressSize)
+{
+}
+
+PerMessageDeflate::~PerMessageDeflate()
+{
+}
+
+bool PerMessageDeflate::valid() const
+{
+    return false;
+}
+
+bool PerMessageDeflate::compress(const uint8_t*, size_t, std::vector<uint8_t>&)
+{
+    return false;
+}
+
+bool PerMessageDeflate::decompress(const uint8_t*, size_t, std::vector<uint8_t>&, size_t)
+{
+    return false;
+}
+
+#endif
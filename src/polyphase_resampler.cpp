@@ -0,0 +1,218 @@
+#include "../include/polyphase_resampler.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <numeric>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define RESAMPLER_USE_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RESAMPLER_USE_NEON 1
+#endif
+
+namespace
+{
+    constexpr double PI = 3.14159265358979323846;
+
+    // 上采样倍数的上限，限制滤波器组的大小
+    constexpr int MAX_PHASES = 1024;
+
+    // 每相的基本抽头数，降采样时按比例加长
+    constexpr int BASE_TAPS = 24;
+
+    // Kaiser窗参数，约80dB阻带衰减
+    constexpr double KAISER_BETA = 8.0;
+
+    // 截止频率留出的过渡带比例
+    constexpr double CUTOFF_RATIO = 0.92;
+
+    // 第一类零阶修正贝塞尔函数
+    double besselI0(double x)
+    {
+        double sum = 1.0;
+        double term = 1.0;
+        for (int k = 1; k < 50; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+            if (term < sum * 1e-12)
+            {
+                break;
+            }
+        }
+        return sum;
+    }
+
+    // 点积，n 为4的倍数
+    inline float dotProduct(const float *a, const float *b, size_t n)
+    {
+#if defined(RESAMPLER_USE_SSE)
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+        }
+        for (; i < n; i += 4)
+        {
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        }
+        acc0 = _mm_add_ps(acc0, acc1);
+        float lanes[4];
+        _mm_storeu_ps(lanes, acc0);
+        return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(RESAMPLER_USE_NEON)
+        float32x4_t acc0 = vdupq_n_f32(0.0f);
+        float32x4_t acc1 = vdupq_n_f32(0.0f);
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+            acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+        }
+        for (; i < n; i += 4)
+        {
+            acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        }
+        acc0 = vaddq_f32(acc0, acc1);
+        return (vgetq_lane_f32(acc0, 0) + vgetq_lane_f32(acc0, 1)) + (vgetq_lane_f32(acc0, 2) + vgetq_lane_f32(acc0, 3));
+#else
+        float sum = 0.0f;
+        for (size_t i = 0; i < n; ++i)
+        {
+            sum += a[i] * b[i];
+        }
+        return sum;
+#endif
+    }
+
+    void reduceRatio(int inputRate, int outputRate, int &up, int &down)
+    {
+        int g = std::gcd(inputRate, outputRate);
+        up = outputRate / g;
+        down = inputRate / g;
+    }
+}
+
+// 一种比例的滤波器组：L 组相位系数，每组 taps 个，倒序存放以便与输入顺序做点积
+struct PolyphaseResampler::FilterBank {
+    int up;
+    int down;
+    size_t taps;
+    std::vector<float> coefficients;   // up * taps
+
+    const float *phase(size_t p) const { return coefficients.data() + p * taps; }
+};
+
+namespace
+{
+    std::shared_ptr<const PolyphaseResampler::FilterBank> buildFilterBank(int up, int down)
+    {
+        auto bank = std::make_shared<PolyphaseResampler::FilterBank>();
+        bank->up = up;
+        bank->down = down;
+
+        // 降采样时截止频率随比例降低，需要相应加长滤波器
+        size_t taps = (size_t)std::ceil(BASE_TAPS * std::max(1.0, (double)down / up));
+        taps = (taps + 3) & ~(size_t)3;
+        bank->taps = taps;
+
+        // 原型低通滤波器工作在上采样后的速率上
+        const size_t length = taps * up;
+        const double cutoff = 0.5 / std::max(up, down) * CUTOFF_RATIO;
+        const double center = (length - 1) / 2.0;
+        const double window = besselI0(KAISER_BETA);
+        std::vector<double> prototype(length);
+        for (size_t j = 0; j < length; ++j)
+        {
+            const double x = j - center;
+            const double sinc = x == 0.0 ? 2.0 * cutoff : std::sin(2.0 * PI * cutoff * x) / (PI * x);
+            const double r = x / (center + 1.0);
+            prototype[j] = sinc * besselI0(KAISER_BETA * std::sqrt(std::max(0.0, 1.0 - r * r))) / window * up;
+        }
+
+        // 拆成相位：相位 p 的第 k 个系数作用于当前时刻之前第 k 个输入样本
+        bank->coefficients.resize(length);
+        for (int p = 0; p < up; ++p)
+        {
+            for (size_t k = 0; k < taps; ++k)
+            {
+                bank->coefficients[p * taps + (taps - 1 - k)] = (float)prototype[p + k * up];
+            }
+        }
+        return bank;
+    }
+
+    // 相同比例的滤波器组只计算一次，所有会话共享
+    std::shared_ptr<const PolyphaseResampler::FilterBank> filterBankFor(int up, int down)
+    {
+        static std::mutex mutex;
+        static std::map<std::pair<int, int>, std::shared_ptr<const PolyphaseResampler::FilterBank>> banks;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto &bank = banks[std::make_pair(up, down)];
+        if (!bank)
+        {
+            bank = buildFilterBank(up, down);
+        }
+        return bank;
+    }
+}
+
+PolyphaseResampler::PolyphaseResampler(int inputRate, int outputRate)
+    : inputRate_(inputRate), outputRate_(outputRate), position_(0)
+{
+    int up, down;
+    reduceRatio(inputRate, outputRate, up, down);
+    bank_ = filterBankFor(up, down);
+    reset();
+}
+
+bool PolyphaseResampler::supported(int inputRate, int outputRate)
+{
+    if (inputRate < 8000 || inputRate > 192000 || outputRate <= 0)
+    {
+        return false;
+    }
+    int up, down;
+    reduceRatio(inputRate, outputRate, up, down);
+    return up <= MAX_PHASES;
+}
+
+void PolyphaseResampler::reset()
+{
+    buffer_.assign(bank_->taps - 1, 0.0f);
+    position_ = 0;
+}
+
+size_t PolyphaseResampler::process(const float *input, size_t count, std::vector<float> &out)
+{
+    const size_t taps = bank_->taps;
+    const uint64_t up = (uint64_t)bank_->up;
+    const uint64_t down = (uint64_t)bank_->down;
+    const size_t history = taps - 1;
+
+    buffer_.insert(buffer_.end(), input, input + count);
+
+    // 输出样本 n 位于上采样时间轴的 position_，对应输入下标 position_ / up，相位 position_ % up
+    const size_t expected = (size_t)((count * up - std::min<uint64_t>(position_, count * up) + down - 1) / down);
+    const size_t offset = out.size();
+    out.reserve(offset + expected);
+    while (position_ < count * up)
+    {
+        const size_t index = (size_t)(position_ / up);
+        const float *phase = bank_->phase((size_t)(position_ % up));
+        out.push_back(dotProduct(phase, buffer_.data() + index, taps));
+        position_ += down;
+    }
+
+    // 保留最后 taps-1 个样本作为下一块的历史
+    position_ -= count * up;
+    buffer_.erase(buffer_.begin(), buffer_.end() - history);
+    return out.size() - offset;
+}
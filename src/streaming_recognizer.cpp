@@ -0,0 +1,353 @@
+#include "../include/streaming_recognizer.h"
+#include "../whisper.cpp/include/whisper.h"
+#include <algorithm>
+
+namespace
+{
+    // 判断token是否以句末标点结尾
+    bool endsSentence(const std::string &text)
+    {
+        static const char *const marks[] = {"。", "！", "？", ".", "!", "?"};
+        size_t end = text.find_last_not_of(' ');
+        if (end == std::string::npos)
+        {
+            return false;
+        }
+        std::string trimmed = text.substr(0, end + 1);
+        for (const char *mark : marks)
+        {
+            size_t len = std::char_traits<char>::length(mark);
+            if (trimmed.size() >= len && trimmed.compare(trimmed.size() - len, len, mark) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 用于去重的已确认token数量
+    constexpr size_t MAX_NGRAM = 5;
+}
+
+StreamingRecognizer::StreamingRecognizer(int sampleRate, size_t bufferSamples)
+    : sampleRate_(sampleRate),
+      maxWindowSamples_(sampleRate * 20),
+      decodeStepSamples_(sampleRate / 4),
+      minDecodeSamples_(sampleRate),
+      encoderChunkSamples_(0),
+      captureSentenceAudio_(false),
+      window_(bufferSamples > 0 ? bufferSamples : (size_t)sampleRate * 30),
+      decodedSamples_(0),
+      mel_(window_.capacity()),
+      committedEnd_(0),
+      maxPromptTokens_(0),
+      promptContext_(nullptr)
+{
+    maxWindowSamples_ = std::min(maxWindowSamples_, window_.capacity());
+}
+
+size_t StreamingRecognizer::appendAudio(const float *samples, size_t count)
+{
+    return window_.write(samples, count);
+}
+
+void StreamingRecognizer::setMaxPromptTokens(size_t tokens)
+{
+    maxPromptTokens_ = tokens;
+    if (promptHistory_.size() > maxPromptTokens_)
+    {
+        promptHistory_.erase(promptHistory_.begin(), promptHistory_.end() - maxPromptTokens_);
+    }
+}
+
+void StreamingRecognizer::setMaxWindowSamples(size_t samples)
+{
+    maxWindowSamples_ = std::min(samples, window_.capacity());
+}
+
+bool StreamingRecognizer::readyToDecode() const
+{
+    const size_t available = window_.readable();
+    return available >= minDecodeSamples_ &&
+           available >= decodedSamples_ + decodeStepSamples_;
+}
+
+bool StreamingRecognizer::hasUndecodedAudio() const
+{
+    const size_t available = window_.readable();
+    return available >= minDecodeSamples_ && available > decodedSamples_;
+}
+
+bool StreamingRecognizer::decode(whisper_context *ctx, whisper_state *state, const whisper_full_params &params, RecognitionUpdate &update)
+{
+    // 取当前可读长度作为本次窗口，解码期间新写入的音频留给下一次
+    const size_t available = window_.readable();
+    if (available < minDecodeSamples_)
+    {
+        return false;
+    }
+
+    decodedSamples_ = available;
+
+    // 分块编码时编码器窗口只覆盖当前音频（编码器每个位置对应两帧，即20毫秒）
+    int audioCtx = params.audio_ctx > 0 ? params.audio_ctx : whisper_model_n_audio_ctx(ctx);
+    if (encoderChunkSamples_ > 0)
+    {
+        const size_t chunks = (available + encoderChunkSamples_ - 1) / encoderChunkSamples_;
+        audioCtx = std::min(audioCtx, (int)(chunks * encoderChunkSamples_ / (2 * MelFrontend::HOP_LENGTH)));
+    }
+
+    // 重叠部分的 log-mel 直接复用，只计算新到达的音频；音频之后补足编码器窗口长度的静音帧
+    int melLength = 0;
+    const int melFrames = mel_.compute(window_.data(), window_.readPosition(), available, whisper_model_n_mels(ctx),
+                                       2 * audioCtx, melBuffer_, melLength);
+    if (melFrames == 0 ||
+        whisper_set_mel_with_state(ctx, state, melBuffer_.data(), melLength, whisper_model_n_mels(ctx)) != 0)
+    {
+        return false;
+    }
+
+    // 不传入PCM时 whisper 无法计算token时间戳，改由 WhisperTokenTimestamps 根据窗口音频计算
+    whisper_full_params melParams = params;
+    melParams.offset_ms = 0;
+    melParams.audio_ctx = audioCtx;
+    melParams.duration_ms = melFrames * (MelFrontend::HOP_LENGTH * 1000 / MelFrontend::SAMPLE_RATE);
+    melParams.token_timestamps = false;
+
+    // 解码状态在会话之间共享，参数中 no_context 为真，上下文只来自本会话的提示
+    buildPrompt(ctx);
+    melParams.prompt_tokens = prompt_.empty() ? nullptr : prompt_.data();
+    melParams.prompt_n_tokens = (int)prompt_.size();
+    if (whisper_full_with_state(ctx, state, melParams, nullptr, 0) != 0)
+    {
+        return false;
+    }
+
+    std::vector<TimedToken> tokens;
+    collectTokens(ctx, state, params, window_.data(), available, tokens);
+
+    dropCommittedPrefix(tokens);
+
+    // LocalAgreement：与上一次假设的最长公共前缀视为稳定
+    size_t agreed = 0;
+    while (agreed < tokens.size() && agreed < hypothesis_.size() &&
+           tokens[agreed].text == hypothesis_[agreed].text)
+    {
+        ++agreed;
+    }
+
+    for (size_t i = 0; i < agreed; ++i)
+    {
+        committedEnd_ = std::max(committedEnd_, tokens[i].t1);
+        committed_.push_back(tokens[i]);
+        committedTail_.push_back(tokens[i]);
+    }
+    if (committedTail_.size() > MAX_NGRAM)
+    {
+        committedTail_.erase(committedTail_.begin(), committedTail_.end() - MAX_NGRAM);
+    }
+    hypothesis_.assign(tokens.begin() + agreed, tokens.end());
+
+    extractSentences(update);
+
+    // 窗口超出上限：先丢弃已确认的音频，仍然超出则强制输出整段
+    if (decodedSamples_ > maxWindowSamples_)
+    {
+        trimWindowTo(committedEnd_);
+        if (decodedSamples_ > maxWindowSamples_)
+        {
+            // 只输出本次解码覆盖的音频，解码期间新写入的音频留在窗口中等待下一次解码
+            std::vector<float> audio;
+            std::string text = flush((uint64_t)windowStart() + decodedSamples_, captureSentenceAudio_ ? &audio : nullptr);
+            if (!text.empty())
+            {
+                update.completed.push_back(text);
+                if (captureSentenceAudio_)
+                {
+                    update.completedAudio.push_back(std::move(audio));
+                }
+            }
+        }
+    }
+
+    update.partial = joinTokens(committed_, 0, committed_.size()) +
+                     joinTokens(hypothesis_, 0, hypothesis_.size());
+    return true;
+}
+
+std::string StreamingRecognizer::flush(uint64_t endPosition, std::vector<float> *audio)
+{
+    std::string text = joinTokens(committed_, 0, committed_.size()) +
+                       joinTokens(hypothesis_, 0, hypothesis_.size());
+    rememberTokens(committed_, 0, committed_.size());
+    rememberTokens(hypothesis_, 0, hypothesis_.size());
+    if (audio != nullptr)
+    {
+        copyAudio(windowStart(), endPosition > (uint64_t)INT64_MAX ? INT64_MAX : (int64_t)endPosition, *audio);
+    }
+    reset(endPosition);
+    return text;
+}
+
+void StreamingRecognizer::reset(uint64_t endPosition)
+{
+    const uint64_t start = window_.readPosition();
+    window_.consume(endPosition > start ? (size_t)std::min<uint64_t>(endPosition - start, window_.readable()) : 0);
+    decodedSamples_ = 0;
+    committed_.clear();
+    committedTail_.clear();
+    hypothesis_.clear();
+    committedEnd_ = windowStart();
+}
+
+void StreamingRecognizer::trimWindowTo(int64_t position)
+{
+    const int64_t start = windowStart();
+    if (position <= start)
+    {
+        return;
+    }
+    size_t count = std::min((size_t)(position - start), window_.readable());
+    window_.consume(count);
+    decodedSamples_ = decodedSamples_ > count ? decodedSamples_ - count : 0;
+}
+
+void StreamingRecognizer::dropCommittedPrefix(std::vector<TimedToken> &hypothesis) const
+{
+    // 丢弃落在已确认音频之内的token（留0.1秒的时间戳误差）
+    const int64_t tolerance = sampleRate_ / 10;
+    hypothesis.erase(std::remove_if(hypothesis.begin(), hypothesis.end(),
+                                    [&](const TimedToken &token)
+                                    { return token.t0 <= committedEnd_ - tolerance; }),
+                     hypothesis.end());
+
+    // 窗口边界附近的重复词：比较已确认尾部与新假设头部的n-gram
+    if (hypothesis.empty() || committedTail_.empty() ||
+        hypothesis.front().t0 - committedEnd_ > sampleRate_)
+    {
+        return;
+    }
+    const size_t limit = std::min({committedTail_.size(), hypothesis.size(), MAX_NGRAM});
+    for (size_t n = 1; n <= limit; ++n)
+    {
+        if (joinTokens(committedTail_, committedTail_.size() - n, committedTail_.size()) ==
+            joinTokens(hypothesis, 0, n))
+        {
+            hypothesis.erase(hypothesis.begin(), hypothesis.begin() + n);
+            break;
+        }
+    }
+}
+
+void StreamingRecognizer::extractSentences(RecognitionUpdate &update)
+{
+    size_t begin = 0;
+    int64_t sentenceEnd = windowStart();
+    for (size_t i = 0; i < committed_.size(); ++i)
+    {
+        if (endsSentence(committed_[i].text))
+        {
+            update.completed.push_back(joinTokens(committed_, begin, i + 1));
+            if (captureSentenceAudio_)
+            {
+                update.completedAudio.emplace_back();
+                copyAudio(sentenceEnd, committed_[i].t1, update.completedAudio.back());
+            }
+            sentenceEnd = committed_[i].t1;
+            begin = i + 1;
+        }
+    }
+    if (begin == 0)
+    {
+        return;
+    }
+
+    // 已输出的句子对应的音频不再参与解码，文本留作上下文
+    rememberTokens(committed_, 0, begin);
+    committed_.erase(committed_.begin(), committed_.begin() + begin);
+    trimWindowTo(sentenceEnd);
+}
+
+void StreamingRecognizer::copyAudio(int64_t begin, int64_t end, std::vector<float> &audio) const
+{
+    const int64_t start = windowStart();
+    const int64_t available = start + (int64_t)window_.readable();
+    begin = std::max(begin, start);
+    end = std::min(end, available);
+    if (end <= begin)
+    {
+        audio.clear();
+        return;
+    }
+    const float *data = window_.data() + (begin - start);
+    audio.assign(data, data + (end - begin));
+}
+
+void StreamingRecognizer::collectTokens(whisper_context *ctx, whisper_state *state, const whisper_full_params &params,
+                                        const float *audio, size_t count, std::vector<TimedToken> &tokens)
+{
+    times_.clear();
+    timestamps_.compute(ctx, state, params.thold_pt, params.thold_ptsum, audio, count, sampleRate_, times_);
+
+    const int64_t start = windowStart();
+    for (const TokenTime &time : times_)
+    {
+        TimedToken timed;
+        timed.id = time.id;
+        timed.text = whisper_token_to_str(ctx, time.id);
+        timed.t0 = start + time.t0 * sampleRate_ / 100;
+        timed.t1 = start + time.t1 * sampleRate_ / 100;
+        tokens.push_back(std::move(timed));
+    }
+}
+
+void StreamingRecognizer::rememberTokens(const std::vector<TimedToken> &tokens, size_t begin, size_t end)
+{
+    if (maxPromptTokens_ == 0)
+    {
+        return;
+    }
+    for (size_t i = begin; i < end; ++i)
+    {
+        promptHistory_.push_back(tokens[i].id);
+    }
+    if (promptHistory_.size() > maxPromptTokens_)
+    {
+        promptHistory_.erase(promptHistory_.begin(), promptHistory_.end() - maxPromptTokens_);
+    }
+}
+
+void StreamingRecognizer::buildPrompt(const whisper_context *ctx)
+{
+    // 模型变化后旧的token编号没有意义
+    if (ctx != promptContext_)
+    {
+        promptHistory_.clear();
+        promptContext_ = ctx;
+    }
+
+    prompt_ = promptHistory_;
+    const int64_t start = windowStart();
+    for (const TimedToken &token : committed_)
+    {
+        if (token.t1 > start)
+        {
+            break;
+        }
+        prompt_.push_back(token.id);
+    }
+    if (prompt_.size() > maxPromptTokens_)
+    {
+        prompt_.erase(prompt_.begin(), prompt_.end() - maxPromptTokens_);
+    }
+}
+
+std::string StreamingRecognizer::joinTokens(const std::vector<TimedToken> &tokens, size_t begin, size_t end)
+{
+    std::string text;
+    for (size_t i = begin; i < end; ++i)
+    {
+        text += tokens[i].text;
+    }
+    return text;
+}
@@ -0,0 +1,276 @@
+#include "../include/token_timestamps.h"
+#include "../whisper.cpp/include/whisper.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // 计算短时能量的半窗长（样本），与 whisper 相同
+    constexpr int ENERGY_HALF_WINDOW = 32;
+
+    // token发音长度的估计，用于在已知时间点之间分配时间（voice_length）
+    float voiceLength(const char *text)
+    {
+        float length = 0.0f;
+        for (; *text != '\0'; ++text)
+        {
+            const char c = *text;
+            if (c == ' ')
+            {
+                length += 0.01f;
+            }
+            else if (c == ',')
+            {
+                length += 2.0f;
+            }
+            else if (c == '.' || c == '!' || c == '?' || (c >= '0' && c <= '9'))
+            {
+                length += 3.0f;
+            }
+            else
+            {
+                length += 1.0f;
+            }
+        }
+        return length;
+    }
+}
+
+void WhisperTokenTimestamps::compute(whisper_context *ctx, whisper_state *state, float tholdPt, float tholdPtsum,
+                                     const float *audio, size_t count, int sampleRate, std::vector<TokenTime> &tokens)
+{
+    // 时间戳token概率足够高的位置作为已知时间点，其间按发音长度等比例分配，
+    // 最后根据短时能量把每个token的边界收缩或扩展到有声音的区域
+    struct TokenTiming {
+        whisper_token id;
+        whisper_token tid;
+        float pt;
+        float ptsum;
+        float vlen;
+        int64_t t0;
+        int64_t t1;
+    };
+
+    // 短时能量：前后各 ENERGY_HALF_WINDOW 个样本的平均幅度
+    const int samples = (int)count;
+    energy_.resize(count);
+    double windowSum = 0.0;
+    for (int i = 0; i < std::min(ENERGY_HALF_WINDOW, samples); ++i)
+    {
+        windowSum += std::fabs(audio[i]);
+    }
+    for (int i = 0; i < samples; ++i)
+    {
+        if (i + ENERGY_HALF_WINDOW < samples)
+        {
+            windowSum += std::fabs(audio[i + ENERGY_HALF_WINDOW]);
+        }
+        if (i - ENERGY_HALF_WINDOW - 1 >= 0)
+        {
+            windowSum -= std::fabs(audio[i - ENERGY_HALF_WINDOW - 1]);
+        }
+        energy_[i] = (float)(windowSum / (2 * ENERGY_HALF_WINDOW + 1));
+    }
+    auto toSample = [&](int64_t t)
+    { return (int)std::max<int64_t>(0, std::min<int64_t>(samples - 1, t * sampleRate / 100)); };
+    auto toTime = [&](int64_t sample)
+    { return sample * 100 / sampleRate; };
+
+    const whisper_token eot = whisper_token_eot(ctx);
+    const whisper_token beg = whisper_token_beg(ctx);
+    int64_t tBegin = 0;
+    int64_t tLast = 0;
+    whisper_token tidLast = 0;
+    std::vector<TokenTiming> timings;
+
+    const int n_segments = whisper_full_n_segments_from_state(state);
+    for (int i = 0; i < n_segments; ++i)
+    {
+        const int64_t t0 = whisper_full_get_segment_t0_from_state(state, i);
+        const int64_t t1 = whisper_full_get_segment_t1_from_state(state, i);
+        const int n = whisper_full_n_tokens_from_state(state, i);
+        timings.clear();
+        for (int j = 0; j < n; ++j)
+        {
+            whisper_token_data data = whisper_full_get_token_data_from_state(state, i, j);
+            timings.push_back({data.id, data.tid, data.pt, data.ptsum, voiceLength(whisper_token_to_str(ctx, data.id)), -1, -1});
+        }
+        if (n == 0)
+        {
+            continue;
+        }
+        if (n == 1)
+        {
+            timings[0].t0 = t0;
+            timings[0].t1 = t1;
+        }
+        else
+        {
+            // 已知时间点：时间戳token的预测
+            for (int j = 0; j < n; ++j)
+            {
+                TokenTiming &token = timings[j];
+                if (j == 0)
+                {
+                    if (token.id == beg)
+                    {
+                        timings[0].t0 = t0;
+                        timings[0].t1 = t0;
+                        timings[1].t0 = t0;
+                        tBegin = t0;
+                        tLast = t0;
+                        tidLast = beg;
+                    }
+                    else
+                    {
+                        timings[0].t0 = tLast;
+                    }
+                }
+                const int64_t tt = tBegin + 2 * (token.tid - beg);
+                if (token.pt > tholdPt && token.ptsum > tholdPtsum && token.tid > tidLast && tt <= t1)
+                {
+                    if (j > 0)
+                    {
+                        timings[j - 1].t1 = tt;
+                    }
+                    token.t0 = tt;
+                    tidLast = token.tid;
+                }
+            }
+            timings[n - 2].t1 = t1;
+            timings[n - 1].t0 = t1;
+            timings[n - 1].t1 = t1;
+            tLast = t1;
+
+            // 未知时间的token按发音长度分配所在区间
+            int p0 = 0;
+            int p1 = 0;
+            while (true)
+            {
+                while (p1 < n && timings[p1].t1 < 0)
+                {
+                    ++p1;
+                }
+                if (p1 >= n)
+                {
+                    --p1;
+                }
+                if (p1 > p0)
+                {
+                    double lengthSum = 0.0;
+                    for (int j = p0; j <= p1; ++j)
+                    {
+                        lengthSum += timings[j].vlen;
+                    }
+                    const double dt = (double)(timings[p1].t1 - timings[p0].t0);
+                    for (int j = p0 + 1; j <= p1; ++j)
+                    {
+                        const int64_t ct = (int64_t)(timings[j - 1].t0 + dt * timings[j - 1].vlen / lengthSum);
+                        timings[j - 1].t1 = ct;
+                        timings[j].t0 = ct;
+                    }
+                }
+                ++p1;
+                p0 = p1;
+                if (p1 >= n)
+                {
+                    break;
+                }
+            }
+
+            // 保证时间单调
+            for (int j = 0; j < n - 1; ++j)
+            {
+                if (timings[j].t1 < 0)
+                {
+                    timings[j + 1].t0 = timings[j].t1;
+                }
+                if (j > 0 && timings[j - 1].t1 > timings[j].t0)
+                {
+                    timings[j].t0 = timings[j - 1].t1;
+                    timings[j].t1 = std::max(timings[j].t0, timings[j].t1);
+                }
+            }
+
+            // 按能量把边界移到有声音的位置
+            const int halfWindow = sampleRate / 8;
+            for (int j = 0; j < n && samples > 0; ++j)
+            {
+                TokenTiming &token = timings[j];
+                if (token.id >= eot)
+                {
+                    continue;
+                }
+                int s0 = toSample(token.t0);
+                int s1 = toSample(token.t1);
+                const int ss0 = std::max(s0 - halfWindow, 0);
+                const int ss1 = std::min(s1 + halfWindow, samples);
+                float sum = 0.0f;
+                for (int k = ss0; k < ss1; ++k)
+                {
+                    sum += energy_[k];
+                }
+                const float threshold = ss1 > ss0 ? 0.5f * sum / (ss1 - ss0) : 0.0f;
+
+                int k = s0;
+                if (energy_[k] > threshold && j > 0)
+                {
+                    while (k > 0 && energy_[k] > threshold)
+                    {
+                        --k;
+                    }
+                    token.t0 = toTime(k);
+                    if (token.t0 < timings[j - 1].t1)
+                    {
+                        token.t0 = timings[j - 1].t1;
+                    }
+                    else
+                    {
+                        s0 = k;
+                    }
+                }
+                else
+                {
+                    while (energy_[k] < threshold && k < s1)
+                    {
+                        ++k;
+                    }
+                    s0 = k;
+                    token.t0 = toTime(k);
+                }
+
+                k = s1;
+                if (energy_[k] > threshold)
+                {
+                    while (k < samples - 1 && energy_[k] > threshold)
+                    {
+                        ++k;
+                    }
+                    token.t1 = toTime(k);
+                    if (j < n - 1 && token.t1 > timings[j + 1].t0)
+                    {
+                        token.t1 = timings[j + 1].t0;
+                    }
+                }
+                else
+                {
+                    while (energy_[k] < threshold && k > s0)
+                    {
+                        --k;
+                    }
+                    token.t1 = toTime(k);
+                }
+            }
+        }
+
+        for (const TokenTiming &token : timings)
+        {
+            if (token.id >= eot)
+            {
+                continue;
+            }
+            tokens.push_back({token.id, token.t0, token.t1});
+        }
+    }
+}
+
@@ -0,0 +1,162 @@
+#include "../include/voice_activity_detector.h"
+#include <algorithm>
+
+namespace
+{
+    constexpr int FRAME_MS = 20;
+
+    // 语音能量至少为背景噪声的倍数（约6dB）
+    constexpr float NOISE_RATIO = 4.0f;
+    // 绝对能量下限（约 -50dBFS），低于此值一律视为静音
+    constexpr float MIN_SPEECH_ENERGY = 1e-5f;
+    // 过零率高于此值且能量不够高的帧视为嘶声类噪声
+    constexpr float NOISE_ZCR = 0.4f;
+    // 背景噪声在静音帧上的更新速度
+    constexpr float NOISE_ADAPT = 0.05f;
+}
+
+VoiceActivityDetector::VoiceActivityDetector(int sampleRate)
+    : frameSize_((size_t)sampleRate * FRAME_MS / 1000),
+      startFrames_(3),
+      endFrames_(600 / FRAME_MS),
+      preRollFrames_(300 / FRAME_MS),
+      preRollHead_(0),
+      preRollCount_(0),
+      inSpeech_(false),
+      speechRun_(0),
+      silenceRun_(0),
+      noiseEnergy_(-1.0f)
+{
+    pending_.reserve(frameSize_);
+    preRoll_.resize(frameSize_ * preRollFrames_);
+}
+
+void VoiceActivityDetector::setEndSilenceMs(int ms)
+{
+    endFrames_ = std::max<size_t>(1, (size_t)ms / FRAME_MS);
+}
+
+void VoiceActivityDetector::reset()
+{
+    pending_.clear();
+    preRollHead_ = 0;
+    preRollCount_ = 0;
+    inSpeech_ = false;
+    speechRun_ = 0;
+    silenceRun_ = 0;
+    noiseEnergy_ = -1.0f;
+}
+
+void VoiceActivityDetector::process(const float *samples, size_t count, const SpeechHandler &onSpeech, const EndHandler &onEnd)
+{
+    size_t pos = 0;
+
+    // 先补齐上次剩下的半帧
+    if (!pending_.empty())
+    {
+        size_t n = std::min(frameSize_ - pending_.size(), count);
+        pending_.insert(pending_.end(), samples, samples + n);
+        pos = n;
+        if (pending_.size() < frameSize_)
+        {
+            return;
+        }
+        processFrame(pending_.data(), onSpeech, onEnd);
+        pending_.clear();
+    }
+
+    for (; pos + frameSize_ <= count; pos += frameSize_)
+    {
+        processFrame(samples + pos, onSpeech, onEnd);
+    }
+    pending_.insert(pending_.end(), samples + pos, samples + count);
+}
+
+bool VoiceActivityDetector::classifyFrame(const float *frame)
+{
+    float energy = 0.0f;
+    size_t crossings = 0;
+    for (size_t i = 0; i < frameSize_; ++i)
+    {
+        energy += frame[i] * frame[i];
+        if (i > 0 && (frame[i] >= 0.0f) != (frame[i - 1] >= 0.0f))
+        {
+            ++crossings;
+        }
+    }
+    energy /= (float)frameSize_;
+    const float zcr = (float)crossings / (float)frameSize_;
+
+    if (noiseEnergy_ < 0.0f)
+    {
+        noiseEnergy_ = energy;
+    }
+
+    const float threshold = std::max(noiseEnergy_ * NOISE_RATIO, MIN_SPEECH_ENERGY);
+    bool speech = energy > threshold;
+    if (speech && zcr > NOISE_ZCR && energy < threshold * 2.0f)
+    {
+        speech = false;
+    }
+
+    // 噪声估计：能量更低时立即跟随，静音帧上缓慢跟随
+    if (energy < noiseEnergy_)
+    {
+        noiseEnergy_ = energy;
+    }
+    else if (!speech)
+    {
+        noiseEnergy_ += (energy - noiseEnergy_) * NOISE_ADAPT;
+    }
+    return speech;
+}
+
+void VoiceActivityDetector::processFrame(const float *frame, const SpeechHandler &onSpeech, const EndHandler &onEnd)
+{
+    const bool speech = classifyFrame(frame);
+
+    if (inSpeech_)
+    {
+        // 语音段内的静音也送入识别，直到静音持续足够长
+        onSpeech(frame, frameSize_);
+        silenceRun_ = speech ? 0 : silenceRun_ + 1;
+        if (silenceRun_ >= endFrames_)
+        {
+            inSpeech_ = false;
+            silenceRun_ = 0;
+            speechRun_ = 0;
+            onEnd();
+        }
+        return;
+    }
+
+    // 语音段外：缓存为前导音频，覆盖最早的一帧
+    size_t slot = (preRollHead_ + preRollCount_) % preRollFrames_;
+    if (preRollCount_ == preRollFrames_)
+    {
+        slot = preRollHead_;
+        preRollHead_ = (preRollHead_ + 1) % preRollFrames_;
+    }
+    else
+    {
+        ++preRollCount_;
+    }
+    std::copy(frame, frame + frameSize_, preRoll_.begin() + slot * frameSize_);
+
+    speechRun_ = speech ? speechRun_ + 1 : 0;
+    if (speechRun_ < startFrames_)
+    {
+        return;
+    }
+
+    // 进入语音段：按时间顺序补发前导音频（其中包含触发的语音帧）
+    inSpeech_ = true;
+    silenceRun_ = 0;
+    for (size_t i = 0; i < preRollCount_; ++i)
+    {
+        size_t index = (preRollHead_ + i) % preRollFrames_;
+        onSpeech(preRoll_.data() + index * frameSize_, frameSize_);
+    }
+    preRollHead_ = 0;
+    preRollCount_ = 0;
+}
@@ -23,15 +23,15 @@ bool VoiceprintRecognition::loadModel(const std::string& model_path) {
     return true;
 }
 
-std::string VoiceprintRecognition::processAudio(const std::vector<float>& audio_data, float sample_rate) {
+std::string VoiceprintRecognition::processAudio(const float* audio_data, size_t count, float sample_rate) {
     std::lock_guard<std::mutex> lock(mutex_);
     
-    if (audio_data.empty()) {
+    if (count == 0) {
         return "unknown";
     }
     
     // 提取声纹特征
-    std::string features = extractFeatures(audio_data);
+    std::string features = extractFeatures(audio_data, count);
     
     // 识别说话人
     std::string speaker = identifySpeaker(features);
@@ -44,7 +44,7 @@ std::string VoiceprintRecognition::processAudio(const std::vector<float>& audio_
     return speaker;
 }
 
-std::string VoiceprintRecognition::extractFeatures(const std::vector<float>& audio_data) {
+std::string VoiceprintRecognition::extractFeatures(const float* audio_data, size_t count) {
     // TODO: 实现声纹特征提取
     // 这里需要实现具体的特征提取算法
     return "features";
@@ -0,0 +1,338 @@
+#include "../include/websocket_frame.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRAME_USE_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FRAME_USE_NEON
+#endif
+
+size_t encodeFrameHeader(uint8_t* out, bool fin, OpCode opcode, uint64_t payloadLength, bool compressed)
+{
+    out[0] = (uint8_t)((fin ? 0x80 : 0x00) | (compressed ? 0x40 : 0x00) | opcode);
+    if (payloadLength < 126) {
+        out[1] = (uint8_t)payloadLength;
+        return 2;
+    }
+    if (payloadLength < 65536) {
+        out[1] = 126;
+        out[2] = (uint8_t)(payloadLength >> 8);
+        out[3] = (uint8_t)payloadLength;
+        return 4;
+    }
+    out[1] = 127;
+    for (int i = 0; i < 8; ++i) {
+        out[2 + i] = (uint8_t)(payloadLength >> ((7 - i) * 8));
+    }
+    return 10;
+}
+
+size_t frameHeaderSize(const uint8_t* header)
+{
+    uint8_t length = header[1] & 0x7F;
+    return length == 127 ? 10 : (length == 126 ? 4 : 2);
+}
+
+void unmaskPayload(uint8_t* data, size_t length, const uint8_t* mask, size_t offset)
+{
+    // 把掩码旋转到与 data 对齐，之后每4字节的掩码都相同
+    uint8_t key[4];
+    for (size_t i = 0; i < 4; ++i) {
+        key[i] = mask[(offset + i) % 4];
+    }
+    uint32_t key32;
+    memcpy(&key32, key, 4);
+
+    size_t i = 0;
+#if defined(FRAME_USE_SSE2)
+    const __m128i key128 = _mm_set1_epi32((int)key32);
+    for (; i + 32 <= length; i += 32) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(data + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(data + i + 16));
+        _mm_storeu_si128((__m128i*)(data + i), _mm_xor_si128(a, key128));
+        _mm_storeu_si128((__m128i*)(data + i + 16), _mm_xor_si128(b, key128));
+    }
+    for (; i + 16 <= length; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(data + i));
+        _mm_storeu_si128((__m128i*)(data + i), _mm_xor_si128(a, key128));
+    }
+#elif defined(FRAME_USE_NEON)
+    const uint8x16_t key128 = vreinterpretq_u8_u32(vdupq_n_u32(key32));
+    for (; i + 32 <= length; i += 32) {
+        uint8x16_t a = vld1q_u8(data + i);
+        uint8x16_t b = vld1q_u8(data + i + 16);
+        vst1q_u8(data + i, veorq_u8(a, key128));
+        vst1q_u8(data + i + 16, veorq_u8(b, key128));
+    }
+    for (; i + 16 <= length; i += 16) {
+        vst1q_u8(data + i, veorq_u8(vld1q_u8(data + i), key128));
+    }
+#endif
+    const uint64_t key64 = ((uint64_t)key32 << 32) | key32;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        word ^= key64;
+        memcpy(data + i, &word, 8);
+    }
+    // 以上每次处理4的整数倍字节，剩余部分仍从 key[0] 开始
+    for (; i < length; ++i) {
+        data[i] ^= key[i % 4];
+    }
+}
+
+WebSocketFrameParser::WebSocketFrameParser()
+    : maxPayloadLength_(UINT64_MAX), reserved_(0), error_(Error::None)
+{
+    reset();
+}
+
+WebSocketFrameParser::~WebSocketFrameParser()
+{
+    releaseReservation();
+}
+
+void WebSocketFrameParser::setLimits(uint64_t maxPayloadLength, std::shared_ptr<MemoryBudget> budget)
+{
+    releaseReservation();
+    maxPayloadLength_ = maxPayloadLength;
+    budget_ = std::move(budget);
+}
+
+void WebSocketFrameParser::reset()
+{
+    releaseReservation();
+    error_ = Error::None;
+    state_ = State::Header;
+    lengthSize_ = 0;
+    masked_ = false;
+    filled_ = 0;
+    payloadLength_ = 0;
+    frame_.fin = false;
+    frame_.compressed = false;
+    frame_.opcode = CONTINUATION;
+    frame_.payload = nullptr;
+    frame_.payloadLength = 0;
+    buffer_.clear();
+}
+
+bool WebSocketFrameParser::feed(uint8_t* data, size_t length, const FrameHandler& onFrame)
+{
+    size_t pos = 0;
+    while (pos < length && error_ == Error::None) {
+        if (state_ == State::Header && filled_ == 0) {
+            size_t used = parseComplete(data + pos, length - pos, onFrame);
+            if (used > 0) {
+                pos += used;
+                continue;
+            }
+            if (error_ != Error::None) {
+                break;
+            }
+        }
+
+        switch (state_) {
+            case State::Header: {
+                header_[filled_++] = data[pos++];
+                if (filled_ == 2) {
+                    finishHeader(onFrame);
+                }
+                break;
+            }
+
+            case State::ExtendedLength: {
+                size_t n = std::min(lengthSize_ - filled_, length - pos);
+                memcpy(lengthBytes_ + filled_, data + pos, n);
+                filled_ += n;
+                pos += n;
+                if (filled_ == lengthSize_) {
+                    payloadLength_ = 0;
+                    for (size_t i = 0; i < lengthSize_; ++i) {
+                        payloadLength_ = (payloadLength_ << 8) | lengthBytes_[i];
+                    }
+                    filled_ = 0;
+                    if (!acceptLength()) {
+                        break;
+                    }
+                    state_ = masked_ ? State::Mask : State::Payload;
+                    if (!masked_ && payloadLength_ == 0) {
+                        deliver(onFrame);
+                    }
+                }
+                break;
+            }
+
+            case State::Mask: {
+                size_t n = std::min((size_t)4 - filled_, length - pos);
+                memcpy(mask_ + filled_, data + pos, n);
+                filled_ += n;
+                pos += n;
+                if (filled_ == 4) {
+                    filled_ = 0;
+                    state_ = State::Payload;
+                    if (payloadLength_ == 0) {
+                        deliver(onFrame);
+                    }
+                }
+                break;
+            }
+
+            case State::Payload: {
+                size_t n = (size_t)std::min<uint64_t>(payloadLength_ - filled_, length - pos);
+                buffer_.insert(buffer_.end(), data + pos, data + pos + n);
+                if (masked_) {
+                    unmaskPayload(buffer_.data() + filled_, n, mask_, filled_);
+                }
+                filled_ += n;
+                pos += n;
+                if (filled_ == payloadLength_) {
+                    deliver(onFrame);
+                }
+                break;
+            }
+        }
+    }
+    return error_ == Error::None;
+}
+
+size_t WebSocketFrameParser::parseComplete(uint8_t* data, size_t length, const FrameHandler& onFrame)
+{
+    if (length < 2) {
+        return 0;
+    }
+    if (!checkHeader(data)) {
+        return 0;
+    }
+    size_t headerSize = 2;
+    uint64_t payloadLength = data[1] & 0x7F;
+    if (payloadLength == 126) {
+        headerSize = 4;
+    } else if (payloadLength == 127) {
+        headerSize = 10;
+    }
+    bool masked = (data[1] & 0x80) != 0;
+    size_t maskOffset = headerSize;
+    if (masked) {
+        headerSize += 4;
+    }
+    if (length < headerSize) {
+        return 0;
+    }
+
+    if (payloadLength == 126) {
+        payloadLength = ((uint64_t)data[2] << 8) | data[3];
+    } else if (payloadLength == 127) {
+        payloadLength = 0;
+        for (size_t i = 0; i < 8; ++i) {
+            payloadLength = (payloadLength << 8) | data[2 + i];
+        }
+    }
+    if (payloadLength > maxPayloadLength_) {
+        error_ = Error::FrameTooLarge;
+        return 0;
+    }
+    if (payloadLength > length - headerSize) {
+        return 0;
+    }
+
+    uint8_t* payload = data + headerSize;
+    if (masked) {
+        unmaskPayload(payload, (size_t)payloadLength, data + maskOffset);
+    }
+    frame_.fin = (data[0] & 0x80) != 0;
+    frame_.compressed = (data[0] & 0x40) != 0;
+    frame_.opcode = (OpCode)(data[0] & 0x0F);
+    frame_.payload = payload;
+    frame_.payloadLength = (size_t)payloadLength;
+    if (!onFrame(frame_)) {
+        error_ = Error::Stopped;
+    }
+    return headerSize + (size_t)payloadLength;
+}
+
+bool WebSocketFrameParser::checkHeader(const uint8_t* header)
+{
+    // 客户端发往服务器的帧必须加掩码（RFC 6455 5.1）；只协商了用到 RSV1 的扩展
+    if ((header[1] & 0x80) == 0 || (header[0] & 0x30) != 0) {
+        error_ = Error::Protocol;
+        return false;
+    }
+    return true;
+}
+
+void WebSocketFrameParser::finishHeader(const FrameHandler& onFrame)
+{
+    if (!checkHeader(header_)) {
+        return;
+    }
+    frame_.fin = (header_[0] & 0x80) != 0;
+    frame_.compressed = (header_[0] & 0x40) != 0;
+    frame_.opcode = (OpCode)(header_[0] & 0x0F);
+    masked_ = (header_[1] & 0x80) != 0;
+    payloadLength_ = header_[1] & 0x7F;
+    filled_ = 0;
+
+    if (payloadLength_ == 126) {
+        lengthSize_ = 2;
+        state_ = State::ExtendedLength;
+    } else if (payloadLength_ == 127) {
+        lengthSize_ = 8;
+        state_ = State::ExtendedLength;
+    } else if (!acceptLength()) {
+        return;
+    } else if (masked_) {
+        state_ = State::Mask;
+    } else {
+        state_ = State::Payload;
+        if (payloadLength_ == 0) {
+            deliver(onFrame);
+        }
+    }
+}
+
+bool WebSocketFrameParser::acceptLength()
+{
+    if (payloadLength_ > maxPayloadLength_) {
+        error_ = Error::FrameTooLarge;
+        return false;
+    }
+    if (payloadLength_ == 0) {
+        return true;
+    }
+    if (budget_ && !budget_->tryReserve((size_t)payloadLength_)) {
+        error_ = Error::OverBudget;
+        return false;
+    }
+    reserved_ = budget_ ? (size_t)payloadLength_ : 0;
+    buffer_.reserve((size_t)payloadLength_);
+    return true;
+}
+
+void WebSocketFrameParser::releaseReservation()
+{
+    if (reserved_ > 0) {
+        budget_->release(reserved_);
+        reserved_ = 0;
+    }
+}
+
+void WebSocketFrameParser::deliver(const FrameHandler& onFrame)
+{
+    frame_.payload = buffer_.data();
+    frame_.payloadLength = buffer_.size();
+    if (!onFrame(frame_)) {
+        error_ = Error::Stopped;
+    }
+    releaseReservation();
+    buffer_.clear();
+    if (buffer_.capacity() > MAX_RETAINED_BUFFER) {
+        std::vector<uint8_t>().swap(buffer_);
+    }
+    state_ = State::Header;
+    filled_ = 0;
+    masked_ = false;
+    payloadLength_ = 0;
+}
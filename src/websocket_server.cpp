@@ -1,5 +1,6 @@
 #include "../include/websocket_client.h"
-#include "../include/voiceprint_recognition.h"
+#include "../include/websocket_frame.h"
+#include "../include/permessage_deflate.h"
 #include <iostream>
 #include <string>
 #include <vector>
@@ -10,11 +11,13 @@
 #include <condition_variable>
 #include <atomic>
 #include <algorithm>
-#include <sstream>
+#include <cstdio>
+#include <cctype>
 #include <random>
 #include <list>
 #include <deque>
 #include <chrono>
+#include <unordered_map>
 
 #ifdef _WIN32
     #include <winsock2.h>
@@ -25,79 +28,534 @@
     #define SOCKET_ERROR_VALUE SOCKET_ERROR
     #define INVALID_SOCKET_VALUE INVALID_SOCKET
     #define CLOSE_SOCKET(s) closesocket(s)
+    #define SHUTDOWN_SOCKET(s) shutdown(s, SD_BOTH)
     #define SOCKET_LAST_ERROR WSAGetLastError()
     #define SOCKET_EWOULDBLOCK WSAEWOULDBLOCK
+    #define SOCKET_EINTR WSAEINTR
     typedef int socklen_t;
 #else
     #include <sys/socket.h>
     #include <arpa/inet.h>
     #include <netinet/in.h>
+    #include <netinet/tcp.h>
     #include <unistd.h>
     #include <fcntl.h>
     #include <netdb.h>
     #include <errno.h>
+    #include <poll.h>
+    #include <sys/uio.h>
     typedef int socket_t;
     #define SOCKET_ERROR_VALUE -1
     #define INVALID_SOCKET_VALUE -1
     #define CLOSE_SOCKET(s) close(s)
+    #define SHUTDOWN_SOCKET(s) shutdown(s, SHUT_RDWR)
     #define SOCKET_LAST_ERROR errno
     #define SOCKET_EWOULDBLOCK EWOULDBLOCK
+    #define SOCKET_EINTR EINTR
 #endif
 
-// WebSocket帧的操作码
-enum OpCode {
-    CONTINUATION = 0x0,
-    TEXT = 0x1,
-    BINARY = 0x2,
-    CLOSE = 0x8,
-    PING = 0x9,
-    PONG = 0xA
+#if defined(__linux__)
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+    #define USE_EPOLL 1
+#elif defined(_WIN32)
+    typedef WSAPOLLFD pollfd_entry;
+    #define POLL_FN WSAPoll
+#else
+    typedef struct pollfd pollfd_entry;
+    #define POLL_FN poll
+#endif
+
+// 对端关闭时不产生SIGPIPE
+#ifdef MSG_NOSIGNAL
+    #define SEND_FLAGS MSG_NOSIGNAL
+#else
+    #define SEND_FLAGS 0
+#endif
+
+// 事件轮询器中的特殊标识
+constexpr uint64_t WAKEUP_TOKEN = UINT64_MAX;      // 唤醒事件
+constexpr uint64_t LISTEN_TOKEN = UINT64_MAX - 1;  // 监听socket
+
+// 单次recv读取的最大字节数
+constexpr size_t READ_CHUNK_SIZE = 64 * 1024;
+
+// 每次可读事件最多recv的次数（即最多读取 8 × 64KB），
+// 读满仍有数据的连接留到本轮其他事件处理完之后再读，一个高速发送的客户端不会独占I/O线程
+constexpr int MAX_READS_PER_EVENT = 8;
+
+// 握手请求的最大长度
+constexpr size_t MAX_HANDSHAKE_SIZE = 8192;
+
+
+// 设置socket为非阻塞模式
+static bool setNonBlocking(socket_t s) {
+#ifdef _WIN32
+    u_long mode = 1;  // 非阻塞模式
+    return ioctlsocket(s, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(s, F_GETFL, 0);
+    return flags != -1 && fcntl(s, F_SETFL, flags | O_NONBLOCK) != -1;
+#endif
+}
+
+// 判断错误码是否表示暂时无法读写
+static bool wouldBlock(int error) {
+#ifdef _WIN32
+    return error == SOCKET_EWOULDBLOCK;
+#else
+    return error == EWOULDBLOCK || error == EAGAIN;
+#endif
+}
+
+// 待发送的一段数据，帧头和负载分别作为一段，发送时不拼接
+struct OutputSlice {
+    const uint8_t* data;
+    size_t length;
+};
+
+// 单次分散写最多的段数
+constexpr size_t MAX_OUTPUT_SLICES = 16;
+
+// 编码好的完整帧，广播时所有连接的发送队列共享同一份缓冲区
+using SharedFrame = std::shared_ptr<const std::vector<uint8_t>>;
+
+// 把负载编码为一个完整帧，只分配一次
+static SharedFrame encodeFrame(OpCode opcode, const uint8_t* payload, size_t length) {
+    auto frame = std::make_shared<std::vector<uint8_t>>(MAX_FRAME_HEADER_SIZE + length);
+    size_t headerSize = encodeFrameHeader(frame->data(), true, opcode, length);
+    if (payload && length > 0) {
+        memcpy(frame->data() + headerSize, payload, length);
+    }
+    frame->resize(headerSize + length);
+    return frame;
+}
+
+// 一次系统调用发送多段数据，返回发送的字节数，失败返回-1
+static long sendSlices(socket_t s, const OutputSlice* slices, size_t count) {
+    count = std::min(count, MAX_OUTPUT_SLICES);
+#ifdef _WIN32
+    WSABUF buffers[MAX_OUTPUT_SLICES];
+    for (size_t i = 0; i < count; ++i) {
+        buffers[i].buf = (char*)slices[i].data;
+        buffers[i].len = (ULONG)slices[i].length;
+    }
+    DWORD sent = 0;
+    if (WSASend(s, buffers, (DWORD)count, &sent, 0, nullptr, nullptr) == SOCKET_ERROR) {
+        return -1;
+    }
+    return (long)sent;
+#else
+    struct iovec iov[MAX_OUTPUT_SLICES];
+    for (size_t i = 0; i < count; ++i) {
+        iov[i].iov_base = (void*)slices[i].data;
+        iov[i].iov_len = slices[i].length;
+    }
+    // 用sendmsg而不是writev，才能带上MSG_NOSIGNAL
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+    return (long)sendmsg(s, &msg, SEND_FLAGS);
+#endif
+}
+
+// 发送队列中的一帧
+struct QueuedFrame {
+    SharedFrame frame;
+    MessageClass messageClass;
+    bool compressible;      // 尚未决定是否压缩的数据帧
+    bool compressed;        // 已压缩，内容已进入压缩上下文，不能再丢弃
 };
 
+struct IoThread;
+
 // 客户端连接
 struct ClientConnection {
     socket_t socket;
-    std::thread* receiveThread;
+    uint64_t handle;                 // 连接句柄，作为事件轮询器中的标识
     std::atomic<bool> connected;
     std::string clientId;
-    std::vector<float> audio_chunk;
-    std::vector<float>::iterator audio_chunk_begin;
-    size_t audio_chunk_last;
-    std::string current_speaker;  // 添加当前说话人字段
+    std::shared_ptr<IoThread> io;    // 所属I/O线程
+    std::shared_ptr<void> context;   // 连接回调返回的上层状态，交给该连接的各个回调，连接关闭后释放
+
+    // 以下字段只由所属的I/O线程访问
+    bool handshakeDone;              // 是否已完成WebSocket握手
+    bool readBacklogged;             // 是否在所属I/O线程的待续读列表中
+    std::string handshakeBuffer;     // 尚未完整的握手请求
+    WebSocketFrameParser parser;     // 帧解析状态机
+    std::vector<uint8_t> inflated;   // 解压缓冲区，跨消息复用
     
-    ClientConnection(socket_t s) : socket(s), receiveThread(nullptr), connected(true), audio_chunk_last(0), current_speaker("unknown") {
-        // 生成随机的客户端ID
+    // 正在接收的分片消息：messageOpcode 为 CONTINUATION 表示没有未完成的消息
+    OpCode messageOpcode;
+    bool messageCompressed;          // 第一个分片的RSV1位
+    bool messageStreaming;           // 分片直接交给分片回调，不重组
+    std::vector<uint8_t> message;    // 重组缓冲区，跨消息复用
+    size_t messageReserved;          // 重组中的消息在内存预算中预留的字节数
+    
+    // 握手时取得的输入限制
+    size_t maxMessageBytes;
+    std::shared_ptr<MemoryBudget> budget;
+
+    // 协商成功时的permessage-deflate上下文（压缩在持有writeMutex时进行）
+    std::unique_ptr<PerMessageDeflate> deflate;
+
+    // 待发送数据（任意线程入队，由所属I/O线程发送）
+    std::mutex writeMutex;
+    std::deque<QueuedFrame> outQueue;    // 尚未发完的帧
+    size_t outOffset;                    // 队首帧已发送的字节数
+    size_t queuedBytes;                  // 队列中所有帧的总字节数
+    std::atomic<bool> pendingOutput;
+
+    ClientConnection(socket_t s, uint64_t h)
+        : socket(s), handle(h), connected(true),
+          handshakeDone(false), readBacklogged(false), messageOpcode(CONTINUATION), messageCompressed(false), messageStreaming(false), messageReserved(0),
+          maxMessageBytes(InputLimits().maxMessageBytes), outOffset(0), queuedBytes(0), pendingOutput(false) {
+        clientId = generateClientId();
+    }
+    
+    // 生成随机的客户端ID
+    static std::string generateClientId() {
         std::random_device rd;
         std::mt19937 gen(rd());
         std::uniform_int_distribution<> dis(10000, 99999);
-        clientId = "user_" + std::to_string(dis(gen));
-        
-        // 初始化音频数据
-        audio_chunk_begin = audio_chunk.begin();
+        return "user_" + std::to_string(dis(gen));
     }
     
     ~ClientConnection() {
-        if (receiveThread && receiveThread->joinable()) {
-            receiveThread->join();
-            delete receiveThread;
-        }
         if (socket != INVALID_SOCKET_VALUE) {
             CLOSE_SOCKET(socket);
         }
+        if (messageReserved > 0) {
+            budget->release(messageReserved);
+        }
+    }
+};
+
+// 事件轮询器
+// Linux上使用边缘触发的epoll；其他平台退化为poll/WSAPoll（水平触发，短超时轮询），
+// 两种实现下调用方都会把socket读写到EWOULDBLOCK为止。
+class Poller {
+public:
+    struct Event {
+        uint64_t token;
+        bool readable;
+        bool writable;
+        bool error;
+    };
+
+    Poller() {}
+
+    ~Poller() {
+        close();
+    }
+
+    bool open() {
+#ifdef USE_EPOLL
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd == -1) {
+            return false;
+        }
+        wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wakeupFd == -1) {
+            return false;
+        }
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.u64 = WAKEUP_TOKEN;
+        return epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeupFd, &ev) == 0;
+#else
+        return true;
+#endif
+    }
+
+    void close() {
+#ifdef USE_EPOLL
+        if (wakeupFd != -1) {
+            ::close(wakeupFd);
+            wakeupFd = -1;
+        }
+        if (epollFd != -1) {
+            ::close(epollFd);
+            epollFd = -1;
+        }
+#else
+        entries.clear();
+#endif
+    }
+
+    // 注册socket，边缘触发下同时关注读写
+    bool add(socket_t s, uint64_t token) {
+#ifdef USE_EPOLL
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.u64 = token;
+        return epoll_ctl(epollFd, EPOLL_CTL_ADD, s, &ev) == 0;
+#else
+        entries.push_back({s, token, false});
+        return true;
+#endif
+    }
+
+    void remove(socket_t s) {
+#ifdef USE_EPOLL
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, s, nullptr);
+#else
+        entries.erase(std::remove_if(entries.begin(), entries.end(),
+            [s](const Entry& e) { return e.socket == s; }), entries.end());
+#endif
+    }
+
+    // 水平触发时只在有积压数据时关注可写事件，边缘触发下无需操作
+    void setWriteInterest(socket_t s, bool enable) {
+#ifdef USE_EPOLL
+        (void)s;
+        (void)enable;
+#else
+        for (auto& e : entries) {
+            if (e.socket == s) {
+                e.wantWrite = enable;
+            }
+        }
+#endif
+    }
+
+    // 等待事件
+    int wait(std::vector<Event>& events, int timeoutMs) {
+        events.clear();
+#ifdef USE_EPOLL
+        struct epoll_event ready[256];
+        int n = epoll_wait(epollFd, ready, 256, timeoutMs);
+        for (int i = 0; i < n; ++i) {
+            if (ready[i].data.u64 == WAKEUP_TOKEN) {
+                uint64_t value;
+                while (read(wakeupFd, &value, sizeof(value)) > 0) {
+                }
+                continue;
+            }
+            Event ev;
+            ev.token = ready[i].data.u64;
+            ev.readable = (ready[i].events & (EPOLLIN | EPOLLRDHUP)) != 0;
+            ev.writable = (ready[i].events & EPOLLOUT) != 0;
+            ev.error = (ready[i].events & (EPOLLERR | EPOLLHUP)) != 0;
+            events.push_back(ev);
+        }
+#else
+        // 没有唤醒fd，用短超时保证新连接和积压数据及时处理
+        std::vector<pollfd_entry> fds;
+        fds.reserve(entries.size());
+        for (const auto& e : entries) {
+            pollfd_entry p;
+            p.fd = e.socket;
+            p.events = POLLIN | (e.wantWrite ? POLLOUT : 0);
+            p.revents = 0;
+            fds.push_back(p);
+        }
+        if (fds.empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(std::min(timeoutMs, 10)));
+            return 0;
+        }
+        int n = POLL_FN(fds.data(), (unsigned long)fds.size(), std::min(timeoutMs, 10));
+        for (size_t i = 0; n > 0 && i < fds.size(); ++i) {
+            if (fds[i].revents == 0) {
+                continue;
+            }
+            Event ev;
+            ev.token = entries[i].token;
+            ev.readable = (fds[i].revents & POLLIN) != 0;
+            ev.writable = (fds[i].revents & POLLOUT) != 0;
+            ev.error = (fds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) != 0;
+            events.push_back(ev);
+        }
+#endif
+        return (int)events.size();
     }
+
+    // 从其他线程唤醒等待中的wait
+    void wakeup() {
+#ifdef USE_EPOLL
+        uint64_t one = 1;
+        ssize_t ignored = write(wakeupFd, &one, sizeof(one));
+        (void)ignored;
+#endif
+    }
+
+private:
+#ifdef USE_EPOLL
+    int epollFd = -1;
+    int wakeupFd = -1;
+#else
+    struct Entry {
+        socket_t socket;
+        uint64_t token;
+        bool wantWrite;
+    };
+    std::vector<Entry> entries;
+#endif
+};
+
+// 网络I/O线程：拥有一个事件轮询器以及分配给它的连接
+struct IoThread {
+    Poller poller;
+    std::thread thread;
+    std::unordered_map<uint64_t, std::shared_ptr<ClientConnection>> connections;  // 仅本线程访问
+    std::vector<std::shared_ptr<ClientConnection>> pending;                       // 等待本线程注册的新连接
+    std::vector<uint64_t> flushRequests;                                          // 发送队列由空变为非空的连接
+    std::mutex pendingMutex;
+    std::vector<uint64_t> flushing;                                               // 仅本线程访问
+    std::vector<uint64_t> readBacklog;                                            // 读满上限仍可读的连接，仅本线程访问
+    std::vector<uint64_t> readServicing;                                          // 仅本线程访问
+    std::vector<uint8_t> readBuffer;
+};
+
+// 已完成握手的连接表
+// 按客户端ID和连接句柄分片加锁，定向发送只锁住一个分片；广播读取写时复制的全量快照，
+// 不加锁。连接的增删远少于消息发送，增删时重建快照的开销可以接受。
+class ConnectionTable {
+public:
+    using ConnectionList = std::vector<std::shared_ptr<ClientConnection>>;
+
+    ConnectionTable() : all(std::make_shared<const ConnectionList>()), count(0) {}
+
+    // 加入连接，客户端ID已被占用时返回false
+    bool insert(const std::shared_ptr<ClientConnection>& client) {
+        {
+            IdShard& shard = shardFor(client->clientId);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (!shard.connections.emplace(client->clientId, client).second) {
+                return false;
+            }
+        }
+        {
+            HandleShard& shard = shardFor(client->handle);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.connections[client->handle] = client;
+        }
+        
+        std::lock_guard<std::mutex> lock(snapshotMutex);
+        auto updated = std::make_shared<ConnectionList>(*std::atomic_load(&all));
+        updated->push_back(client);
+        std::atomic_store(&all, std::shared_ptr<const ConnectionList>(std::move(updated)));
+        ++count;
+        return true;
+    }
+    
+    // 移除连接，不在表中时返回false
+    bool remove(const std::shared_ptr<ClientConnection>& client) {
+        {
+            IdShard& shard = shardFor(client->clientId);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto it = shard.connections.find(client->clientId);
+            if (it == shard.connections.end() || it->second != client) {
+                return false;
+            }
+            shard.connections.erase(it);
+        }
+        {
+            HandleShard& shard = shardFor(client->handle);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.connections.erase(client->handle);
+        }
+        
+        std::lock_guard<std::mutex> lock(snapshotMutex);
+        auto updated = std::make_shared<ConnectionList>();
+        std::shared_ptr<const ConnectionList> current = std::atomic_load(&all);
+        updated->reserve(current->size());
+        for (const auto& c : *current) {
+            if (c != client) {
+                updated->push_back(c);
+            }
+        }
+        std::atomic_store(&all, std::shared_ptr<const ConnectionList>(std::move(updated)));
+        --count;
+        return true;
+    }
+    
+    // 按客户端ID查找
+    std::shared_ptr<ClientConnection> findById(const std::string& clientId) {
+        IdShard& shard = shardFor(clientId);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.connections.find(clientId);
+        return it != shard.connections.end() ? it->second : nullptr;
+    }
+    
+    // 按连接句柄查找
+    std::shared_ptr<ClientConnection> findByHandle(uint64_t handle) {
+        HandleShard& shard = shardFor(handle);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.connections.find(handle);
+        return it != shard.connections.end() ? it->second : nullptr;
+    }
+    
+    // 所有连接的快照，持有期间不受增删影响
+    std::shared_ptr<const ConnectionList> snapshot() const {
+        return std::atomic_load(&all);
+    }
+    
+    size_t size() const {
+        return count;
+    }
+    
+    void clear() {
+        for (auto& shard : idShards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.connections.clear();
+        }
+        for (auto& shard : handleShards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.connections.clear();
+        }
+        std::lock_guard<std::mutex> lock(snapshotMutex);
+        std::atomic_store(&all, std::make_shared<const ConnectionList>());
+        count = 0;
+    }
+
+private:
+    static constexpr size_t SHARD_COUNT = 16;
+
+    // 每个分片独占缓存行，避免不同分片的锁互相干扰
+    struct alignas(64) IdShard {
+        std::mutex mutex;
+        std::unordered_map<std::string, std::shared_ptr<ClientConnection>> connections;
+    };
+    struct alignas(64) HandleShard {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, std::shared_ptr<ClientConnection>> connections;
+    };
+
+    IdShard& shardFor(const std::string& clientId) {
+        return idShards[std::hash<std::string>()(clientId) % SHARD_COUNT];
+    }
+    HandleShard& shardFor(uint64_t handle) {
+        return handleShards[handle % SHARD_COUNT];
+    }
+
+    IdShard idShards[SHARD_COUNT];
+    HandleShard handleShards[SHARD_COUNT];
+    std::shared_ptr<const ConnectionList> all;   // 以原子方式替换
+    std::mutex snapshotMutex;                    // 串行化快照的重建
+    std::atomic<size_t> count;
 };
 
 // WebSocket实现类
 class WebSocketImpl {
 public:
-    WebSocketImpl() : serverSocket(INVALID_SOCKET_VALUE), running(false), acceptThread(nullptr), cleanupThreadRunning(false) {}
+    using ConnectCallback = std::function<std::shared_ptr<void>(const std::string&)>;
+    using ReceiveCallback = std::function<void(const std::string&, const std::string&, void*)>;
+    using BinaryCallback = std::function<void(const uint8_t*, size_t, const std::string&, void*)>;
+    using BinaryFragmentCallback = std::function<void(const uint8_t*, size_t, bool, bool, const std::string&, void*)>;
+    using DisconnectCallback = std::function<void(const std::string&, void*)>;
+
+    WebSocketImpl() : serverSocket(INVALID_SOCKET_VALUE), running(false), nextIoThread(0), nextHandle(1), monitorThread(nullptr), monitorThreadRunning(false) {}
     
     ~WebSocketImpl() {
         stop();
     }
     
     // 启动WebSocket服务器
-    bool start(int port) {
+    bool start(int port, int ioThreadCount) {
 #ifdef _WIN32
         // 初始化Winsock
         WSADATA wsaData;
@@ -121,10 +579,7 @@ public:
         int yes = 1;
         if (setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, (char*)&yes, sizeof(yes)) == SOCKET_ERROR_VALUE) {
             std::cerr << "设置SO_REUSEADDR失败" << std::endl;
-            CLOSE_SOCKET(serverSocket);
-#ifdef _WIN32
-            WSACleanup();
-#endif
+            closeServerSocket();
             return false;
         }
         
@@ -141,203 +596,192 @@ public:
         
         if (bind(serverSocket, (struct sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR_VALUE) {
             std::cerr << "绑定地址失败" << std::endl;
-            CLOSE_SOCKET(serverSocket);
-#ifdef _WIN32
-            WSACleanup();
-#endif
+            closeServerSocket();
             return false;
         }
         
         // 开始监听
-        if (listen(serverSocket, SOMAXCONN) == SOCKET_ERROR_VALUE) {
+        if (listen(serverSocket, SOMAXCONN) == SOCKET_ERROR_VALUE || !setNonBlocking(serverSocket)) {
             std::cerr << "监听失败" << std::endl;
-            CLOSE_SOCKET(serverSocket);
-#ifdef _WIN32
-            WSACleanup();
-#endif
+            closeServerSocket();
+            return false;
+        }
+        
+        // 创建I/O线程的事件轮询器，监听socket由第一个I/O线程负责
+        if (ioThreadCount <= 0) {
+            ioThreadCount = (int)std::max(1u, std::min(4u, std::thread::hardware_concurrency() / 2));
+        }
+        for (int i = 0; i < ioThreadCount; ++i) {
+            std::shared_ptr<IoThread> io = std::make_shared<IoThread>();
+            io->readBuffer.resize(READ_CHUNK_SIZE);
+            if (!io->poller.open()) {
+                std::cerr << "创建事件轮询器失败" << std::endl;
+                ioThreads.clear();
+                closeServerSocket();
+                return false;
+            }
+            ioThreads.push_back(std::move(io));
+        }
+        if (!ioThreads[0]->poller.add(serverSocket, LISTEN_TOKEN)) {
+            std::cerr << "注册监听socket失败" << std::endl;
+            ioThreads.clear();
+            closeServerSocket();
             return false;
         }
         
         running = true;
-        cleanupThreadRunning = true;
+        monitorThreadRunning = true;
         
-        // 启动接收线程
-        acceptThread = new std::thread(&WebSocketImpl::acceptLoop, this);
+        // 启动I/O线程
+        for (auto& io : ioThreads) {
+            io->thread = std::thread(&WebSocketImpl::ioLoop, this, io.get());
+        }
         
-        // 启动清理线程
-        cleanupThread = new std::thread(&WebSocketImpl::cleanupLoop, this);
+        // 启动统计线程
+        monitorThread = new std::thread(&WebSocketImpl::monitorLoop, this);
         
-        std::cout << "WebSocket服务器已启动，监听端口: " << port << std::endl;
+        std::cout << "WebSocket服务器已启动，监听端口: " << port << "，I/O线程数: " << ioThreadCount << std::endl;
         return true;
     }
     
     // 停止服务器
     void stop() {
         running = false;
-        cleanupThreadRunning = false;
-        
-        // 关闭所有客户端连接
         {
-            std::lock_guard<std::mutex> lock(clientsMutex);
-            for (auto& client : clients) {
-                client->connected = false;
-                
-                // 清理用户的音频数据
-                client->audio_chunk.clear();
-                client->audio_chunk_begin = client->audio_chunk.begin();
-                client->audio_chunk_last = 0;
-                
-                sendFrame(client->socket, CLOSE, nullptr, 0);
-                CLOSE_SOCKET(client->socket);
+            std::lock_guard<std::mutex> lock(monitorMutex);
+            monitorThreadRunning = false;
+        }
+        monitorCondition.notify_all();
+        
+        // 等待I/O线程结束，各线程退出前关闭自己的连接
+        for (auto& io : ioThreads) {
+            io->poller.wakeup();
+        }
+        for (auto& io : ioThreads) {
+            if (io->thread.joinable()) {
+                io->thread.join();
             }
-            clients.clear();
-            disconnectedClients.clear();
         }
+        ioThreads.clear();
         
         // 关闭服务器socket
         if (serverSocket != INVALID_SOCKET_VALUE) {
             CLOSE_SOCKET(serverSocket);
             serverSocket = INVALID_SOCKET_VALUE;
+#ifdef _WIN32
+            WSACleanup();
+#endif
         }
         
-        // 等待accept线程结束
-        if (acceptThread && acceptThread->joinable()) {
-            acceptThread->join();
-            delete acceptThread;
-            acceptThread = nullptr;
-        }
+        connections.clear();
         
-        // 等待清理线程结束
-        if (cleanupThread && cleanupThread->joinable()) {
-            cleanupThread->join();
-            delete cleanupThread;
-            cleanupThread = nullptr;
+        // 等待统计线程结束
+        if (monitorThread && monitorThread->joinable()) {
+            monitorThread->join();
+            delete monitorThread;
+            monitorThread = nullptr;
         }
-        
-#ifdef _WIN32
-        WSACleanup();
-#endif
     }
     
     // 广播文本消息给所有客户端
-    bool broadcastText(const std::string& message, const std::string& targetClientId = "") {
-        cleanupDisconnectedClients();
-        
-        std::lock_guard<std::mutex> lock(clientsMutex);
-        bool success = true;
-        
-        // 检查是否需要发送给特定客户端
-        if (!targetClientId.empty()) {
-            // 查找特定客户端
-            auto it = std::find_if(clients.begin(), clients.end(), [&targetClientId](const std::shared_ptr<ClientConnection>& client) {
-                return client->clientId == targetClientId && client->connected;
-            });
-            
-            if (it != clients.end()) {
-                // 发送给特定客户端
-                auto client = *it;
-                if (!sendFrame(client->socket, TEXT, (const uint8_t*)message.c_str(), message.length())) {
-                    success = false;
-                    client->connected = false;
-                }
-            } else {
-                // 未找到指定客户端
-                success = false;
-            }
-        } else {
-            // 广播给所有客户端
-            for (auto it = clients.begin(); it != clients.end();) {
-                auto client = *it;
-                if (client->connected) {
-                    if (!sendFrame(client->socket, TEXT, (const uint8_t*)message.c_str(), message.length())) {
-                        success = false;
-                        client->connected = false;
-                        // 安全地标记客户端为断开状态，而不是立即删除
-                        std::lock_guard<std::mutex> disconnectLock(disconnectedClientsMutex);
-                        disconnectedClients.push_back(client);
-                        ++it;
-                    } else {
-                        ++it;
-                    }
-                } else {
-                    // 安全地标记客户端为断开状态，而不是立即删除
-                    std::lock_guard<std::mutex> disconnectLock(disconnectedClientsMutex);
-                    disconnectedClients.push_back(client);
-                    ++it;
-                }
-            }
-        }
-        
-        return success;
+    bool broadcastText(const std::string& message, const std::string& targetClientId = "", MessageClass messageClass = MessageClass::Reliable) {
+        // 只编码一次，所有接收者共享同一个帧
+        return deliverFrame(encodeFrame(TEXT, (const uint8_t*)message.data(), message.length()), targetClientId, messageClass);
     }
     
     // 广播二进制数据给所有客户端
     bool broadcastBinary(const std::vector<float>& data, const std::string& targetClientId = "") {
-        cleanupDisconnectedClients();
-        
-        // 将浮点数组转换为JSON格式的字符串
-        std::stringstream ss;
-        ss << "[";
+        // 将浮点数组转换为JSON格式的字符串（与流输出的默认精度一致）
+        std::string json;
+        json.reserve(data.size() * 12 + 2);
+        json += '[';
+        char number[32];
         for (size_t i = 0; i < data.size(); ++i) {
-            ss << data[i];
-            if (i < data.size() - 1) {
-                ss << ",";
+            if (i > 0) {
+                json += ',';
             }
+            int n = snprintf(number, sizeof(number), "%g", data[i]);
+            json.append(number, (size_t)std::max(n, 0));
         }
-        ss << "]";
+        json += ']';
         
-        std::lock_guard<std::mutex> lock(clientsMutex);
-        bool success = true;
+        return deliverFrame(encodeFrame(TEXT, (const uint8_t*)json.data(), json.length()), targetClientId, MessageClass::Reliable);
+    }
+    
+    // 设置发送队列限制
+    void setOutboundQueueOptions(const OutboundQueueOptions& options) {
+        std::lock_guard<std::mutex> lock(optionsMutex);
+        queueOptions = options;
+    }
+    
+    // 设置permessage-deflate配置，对之后握手的连接生效
+    void setCompressionOptions(const DeflateOptions& options) {
+        std::lock_guard<std::mutex> lock(optionsMutex);
+        deflateOptions = options;
+    }
+    
+    // 设置输入限制和共享的内存预算，对之后握手的连接生效
+    void setInputLimits(const InputLimits& limits, std::shared_ptr<MemoryBudget> budget) {
+        std::lock_guard<std::mutex> lock(optionsMutex);
+        inputLimits = limits;
+        memoryBudget = std::move(budget);
+    }
+    
+    // 输入限制统计
+    InputLimitStats inputLimitStats() {
+        InputLimitStats stats;
+        stats.oversizedFrames = oversizedFrames;
+        stats.oversizedMessages = oversizedMessages;
+        stats.budgetRejects = budgetRejects;
+        std::lock_guard<std::mutex> lock(optionsMutex);
+        stats.budgetUsed = memoryBudget ? memoryBudget->used() : 0;
+        return stats;
+    }
+    
+    // 汇总所有连接的发送队列
+    OutboundQueueStats outboundQueueStats() {
+        std::shared_ptr<const ConnectionTable::ConnectionList> snapshot = connections.snapshot();
         
-        // 检查是否需要发送给特定客户端
-        if (!targetClientId.empty()) {
-            // 查找特定客户端
-            auto it = std::find_if(clients.begin(), clients.end(), [&targetClientId](const std::shared_ptr<ClientConnection>& client) {
-                return client->clientId == targetClientId && client->connected;
-            });
-            
-            if (it != clients.end()) {
-                // 发送给特定客户端
-                auto client = *it;
-                if (!sendFrame(client->socket, TEXT, (const uint8_t*)ss.str().c_str(), ss.str().length())) {
-                    success = false;
-                    client->connected = false;
-                }
-            } else {
-                // 未找到指定客户端
-                success = false;
-            }
-        } else {
-            // 广播给所有客户端
-            for (auto it = clients.begin(); it != clients.end();) {
-                auto client = *it;
-                if (client->connected) {
-                    if (!sendFrame(client->socket, TEXT, (const uint8_t*)ss.str().c_str(), ss.str().length())) {
-                        success = false;
-                        client->connected = false;
-                        // 安全地标记客户端为断开状态，而不是立即删除
-                        std::lock_guard<std::mutex> disconnectLock(disconnectedClientsMutex);
-                        disconnectedClients.push_back(client);
-                        ++it;
-                    } else {
-                        ++it;
-                    }
-                } else {
-                    // 安全地标记客户端为断开状态，而不是立即删除
-                    std::lock_guard<std::mutex> disconnectLock(disconnectedClientsMutex);
-                    disconnectedClients.push_back(client);
-                    ++it;
-                }
+        OutboundQueueStats stats;
+        for (auto& client : *snapshot) {
+            std::lock_guard<std::mutex> lock(client->writeMutex);
+            if (client->socket == INVALID_SOCKET_VALUE) {
+                continue;
             }
+            ++stats.connections;
+            stats.queuedFrames += client->outQueue.size();
+            stats.queuedBytes += client->queuedBytes;
+            stats.maxQueuedBytes = std::max(stats.maxQueuedBytes, client->queuedBytes);
         }
-        
-        return success;
+        stats.droppedPartials = droppedPartials;
+        stats.coalescedPartials = coalescedPartials;
+        stats.slowDisconnects = slowDisconnects;
+        return stats;
+    }
+    
+    // 设置连接建立回调
+    void setConnectCallback(ConnectCallback callback) {
+        std::atomic_store(&connectCallback, std::make_shared<const ConnectCallback>(std::move(callback)));
     }
     
     // 设置消息接收回调
-    void setReceiveCallback(std::function<void(const std::string&, const std::string&)> callback) {
-        std::lock_guard<std::mutex> lock(callbackMutex);
-        receiveCallback = callback;
+    void setReceiveCallback(ReceiveCallback callback) {
+        std::atomic_store(&receiveCallback, std::make_shared<const ReceiveCallback>(std::move(callback)));
+    }
+    
+    // 设置二进制消息回调
+    void setBinaryCallback(BinaryCallback callback) {
+        std::atomic_store(&binaryCallback, std::make_shared<const BinaryCallback>(std::move(callback)));
+    }
+    
+    // 设置连接关闭回调
+    void setDisconnectCallback(DisconnectCallback callback) {
+        std::atomic_store(&disconnectCallback, std::make_shared<const DisconnectCallback>(std::move(callback)));
+    }
+    
+    // 设置二进制分片回调，空回调表示分片消息重组后再交给二进制消息回调
+    void setBinaryFragmentCallback(BinaryFragmentCallback callback) {
+        std::atomic_store(&binaryFragmentCallback, std::make_shared<const BinaryFragmentCallback>(std::move(callback)));
     }
     
     // 检查是否正在运行
@@ -346,71 +790,289 @@ public:
     }
     
 private:
-    // 接受新客户端连接的线程函数
-    void acceptLoop() {
+    // I/O线程主循环
+    void ioLoop(IoThread* io) {
+        std::vector<Poller::Event> events;
+        while (running) {
+            registerPendingConnections(io);
+            flushRequestedConnections(io);
+            
+#ifndef USE_EPOLL
+            for (auto& entry : io->connections) {
+                io->poller.setWriteInterest(entry.second->socket, entry.second->pendingOutput);
+            }
+#endif
+            
+            // 有待续读的连接时不阻塞等待
+            io->poller.wait(events, io->readBacklog.empty() ? 100 : 0);
+            for (const auto& ev : events) {
+                if (ev.token == LISTEN_TOKEN) {
+                    acceptConnections();
+                    continue;
+                }
+                
+                auto it = io->connections.find(ev.token);
+                if (it == io->connections.end()) {
+                    continue;
+                }
+                std::shared_ptr<ClientConnection> client = it->second;
+                
+                if (ev.writable) {
+                    flushOutput(client);
+                }
+                if (ev.readable || ev.error) {
+                    handleReadable(io, client);
+                }
+                if (!client->connected) {
+                    closeConnection(io, client);
+                }
+            }
+            
+            serviceReadBacklog(io);
+        }
+        
+        // 退出前通知并关闭本线程的所有连接
+        for (auto& entry : io->connections) {
+            auto& client = entry.second;
+            sendFrame(client, CLOSE, nullptr, 0);
+            io->poller.remove(client->socket);
+            std::lock_guard<std::mutex> lock(client->writeMutex);
+            client->connected = false;
+            if (client->socket != INVALID_SOCKET_VALUE) {
+                CLOSE_SOCKET(client->socket);
+                client->socket = INVALID_SOCKET_VALUE;
+            }
+        }
+        io->connections.clear();
+    }
+    
+    // 把分配给本线程的新连接注册到事件轮询器
+    void registerPendingConnections(IoThread* io) {
+        std::vector<std::shared_ptr<ClientConnection>> added;
+        {
+            std::lock_guard<std::mutex> lock(io->pendingMutex);
+            if (io->pending.empty()) {
+                return;
+            }
+            added.swap(io->pending);
+        }
+        
+        for (auto& client : added) {
+            if (!io->poller.add(client->socket, client->handle)) {
+                std::cerr << "注册客户端连接失败" << std::endl;
+                continue;
+            }
+            io->connections[client->handle] = client;
+            // 注册前可能已有握手数据到达，边缘触发下需要主动读一次
+            handleReadable(io, client);
+            if (!client->connected) {
+                closeConnection(io, client);
+            }
+        }
+    }
+    
+    // 继续读取上一轮读满上限的连接，每个连接同样最多读 MAX_READS_PER_EVENT 次
+    void serviceReadBacklog(IoThread* io) {
+        if (io->readBacklog.empty()) {
+            return;
+        }
+        io->readServicing.swap(io->readBacklog);
+        for (uint64_t handle : io->readServicing) {
+            auto it = io->connections.find(handle);
+            if (it == io->connections.end()) {
+                continue;
+            }
+            std::shared_ptr<ClientConnection> client = it->second;
+            client->readBacklogged = false;
+            handleReadable(io, client);
+            if (!client->connected) {
+                closeConnection(io, client);
+            }
+        }
+        io->readServicing.clear();
+    }
+    
+    // 发送其他线程入队的数据
+    void flushRequestedConnections(IoThread* io) {
+        {
+            std::lock_guard<std::mutex> lock(io->pendingMutex);
+            if (io->flushRequests.empty()) {
+                return;
+            }
+            io->flushing.swap(io->flushRequests);
+        }
+        
+        for (uint64_t handle : io->flushing) {
+            auto it = io->connections.find(handle);
+            if (it == io->connections.end()) {
+                continue;
+            }
+            std::shared_ptr<ClientConnection> client = it->second;
+            flushOutput(client);
+            if (!client->connected) {
+                closeConnection(io, client);
+            }
+        }
+        io->flushing.clear();
+    }
+    
+    // 接受新客户端连接，轮流分配给各I/O线程
+    void acceptConnections() {
         while (running) {
-            // 接受新的客户端连接
             struct sockaddr_in clientAddr;
             socklen_t addrLen = sizeof(clientAddr);
             socket_t clientSocket = accept(serverSocket, (struct sockaddr*)&clientAddr, &addrLen);
             
             if (clientSocket == INVALID_SOCKET_VALUE) {
-                if (running) {
+                int error = SOCKET_LAST_ERROR;
+                if (!wouldBlock(error) && error != SOCKET_EINTR && running) {
                     std::cerr << "接受客户端连接失败" << std::endl;
                 }
-                break;
+                if (error == SOCKET_EINTR) {
+                    continue;
+                }
+                break;
+            }
+            
+            if (!setNonBlocking(clientSocket)) {
+                CLOSE_SOCKET(clientSocket);
+                continue;
+            }
+            
+            // 识别结果是小消息，关闭Nagle算法降低延迟
+            int yes = 1;
+            setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, (char*)&yes, sizeof(yes));
+#ifdef SO_NOSIGPIPE
+            setsockopt(clientSocket, SOL_SOCKET, SO_NOSIGPIPE, (char*)&yes, sizeof(yes));
+#endif
+            
+            // 获取客户端IP地址
+            char clientIP[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &(clientAddr.sin_addr), clientIP, INET_ADDRSTRLEN);
+            std::cout << "新客户端连接: " << clientIP << std::endl;
+            
+            auto client = std::make_shared<ClientConnection>(clientSocket, nextHandle++);
+            std::shared_ptr<IoThread> io = ioThreads[nextIoThread++ % ioThreads.size()];
+            client->io = io;
+            {
+                std::lock_guard<std::mutex> lock(io->pendingMutex);
+                io->pending.push_back(client);
+            }
+            io->poller.wakeup();
+        }
+    }
+    
+    // 读取socket直到没有更多数据或达到单次事件的读取上限；
+    // 达到上限时socket中可能还有数据，边缘触发下不会再有通知，加入待续读列表
+    void handleReadable(IoThread* io, const std::shared_ptr<ClientConnection>& client) {
+        for (int reads = 0; client->connected; ++reads) {
+            if (reads == MAX_READS_PER_EVENT) {
+                if (!client->readBacklogged) {
+                    client->readBacklogged = true;
+                    io->readBacklog.push_back(client->handle);
+                }
+                break;
+            }
+            int bytesRead = recv(client->socket, (char*)io->readBuffer.data(), (int)io->readBuffer.size(), 0);
+            
+            if (bytesRead > 0) {
+                consumeInput(client, io->readBuffer.data(), (size_t)bytesRead);
+                continue;
+            }
+            
+            if (bytesRead == 0) {
+                // 连接已断开
+                std::cout << "检测到客户端连接断开: " << client->clientId << std::endl;
+                client->connected = false;
+                break;
+            }
+            
+            int error = SOCKET_LAST_ERROR;
+            if (wouldBlock(error)) {
+                break;
+            }
+            if (error != SOCKET_EINTR) {
+                client->connected = false;
+            }
+        }
+    }
+    
+    // 处理收到的字节：握手阶段累积HTTP请求，之后交给帧解析状态机（解析器原地去掩码，data 会被修改）
+    void consumeInput(const std::shared_ptr<ClientConnection>& client, uint8_t* data, size_t length) {
+        if (!client->handshakeDone) {
+            client->handshakeBuffer.append((const char*)data, length);
+            size_t headerEnd = client->handshakeBuffer.find("\r\n\r\n");
+            if (headerEnd == std::string::npos) {
+                if (client->handshakeBuffer.size() > MAX_HANDSHAKE_SIZE) {
+                    client->connected = false;
+                }
+                return;
             }
             
-            // 获取客户端IP地址
-            char clientIP[INET_ADDRSTRLEN];
-            inet_ntop(AF_INET, &(clientAddr.sin_addr), clientIP, INET_ADDRSTRLEN);
-            std::cout << "新客户端连接: " << clientIP << std::endl;
+            std::string request = client->handshakeBuffer.substr(0, headerEnd + 4);
+            std::string rest = client->handshakeBuffer.substr(headerEnd + 4);
+            client->handshakeBuffer.clear();
+            client->handshakeBuffer.shrink_to_fit();
             
-            // 处理WebSocket握手
-            if (handleHandshake(clientSocket)) {
-                // 创建客户端连接对象
-                auto client = std::make_shared<ClientConnection>(clientSocket);
-                
-                // 添加到客户端列表
-                {
-                    std::lock_guard<std::mutex> lock(clientsMutex);
-                    clients.push_back(client);
-                    std::cout << "已添加客户端: " << client->clientId << "，当前连接数: " << clients.size() << std::endl;
-                }
-                
-                // 启动接收线程
-                client->receiveThread = new std::thread(&WebSocketImpl::receiveLoop, this, client);
-            } else {
-                CLOSE_SOCKET(clientSocket);
+            if (!handleHandshake(client, request)) {
+                client->connected = false;
+                return;
             }
+            client->handshakeDone = true;
+            {
+                std::lock_guard<std::mutex> lock(optionsMutex);
+                client->maxMessageBytes = inputLimits.maxMessageBytes;
+                client->budget = memoryBudget;
+                client->parser.setLimits(inputLimits.maxFrameBytes, memoryBudget);
+            }
+            
+            // 添加到连接表，客户端ID重复时重新生成
+            while (!connections.insert(client)) {
+                client->clientId = ClientConnection::generateClientId();
+            }
+            std::cout << "已添加客户端: " << client->clientId << "，当前连接数: " << connections.size() << std::endl;
+            
+            // 上层在这里建立该连接的状态，之后的回调直接带上它
+            std::shared_ptr<const ConnectCallback> connectHandler = std::atomic_load(&connectCallback);
+            if (connectHandler && *connectHandler) {
+                client->context = (*connectHandler)(client->clientId);
+            }
+            
+            if (rest.empty()) {
+                return;
+            }
+            feedFrames(client, (uint8_t*)&rest[0], rest.size());
+            return;
         }
+        
+        feedFrames(client, data, length);
     }
     
-    // 处理WebSocket握手
-    bool handleHandshake(socket_t clientSocket) {
-        char buffer[4096] = {0};
-        int bytesRead = recv(clientSocket, buffer, sizeof(buffer) - 1, 0);
-        if (bytesRead <= 0) {
-            return false;
+    // 把收到的字节交给帧解析状态机，帧超出限制或违反协议时断开连接
+    // 处理某个帧时连接被标记关闭（CLOSE帧、协议错误），同一次读取中之后的帧不再处理
+    void feedFrames(const std::shared_ptr<ClientConnection>& client, uint8_t* data, size_t length) {
+        bool ok = client->parser.feed(data, length, [this, &client](WebSocketFrame& frame) {
+            handleFrame(client, frame);
+            return client->connected.load();
+        });
+        if (ok || client->parser.error() == WebSocketFrameParser::Error::Stopped) {
+            return;
         }
-        
-        buffer[bytesRead] = '\0';
-        
-        // 解析HTTP请求
-        std::string request(buffer);
-        std::string key;
-        
-        // 查找Sec-WebSocket-Key头
-        const std::string keyMarker = "Sec-WebSocket-Key: ";
-        size_t keyStart = request.find(keyMarker);
-        if (keyStart != std::string::npos) {
-            keyStart += keyMarker.length();
-            size_t keyEnd = request.find("\r\n", keyStart);
-            if (keyEnd != std::string::npos) {
-                key = request.substr(keyStart, keyEnd - keyStart);
-            }
+        if (client->parser.error() == WebSocketFrameParser::Error::FrameTooLarge) {
+            ++oversizedFrames;
+            std::cerr << "帧超过长度上限，断开连接: " << client->clientId << std::endl;
+        } else if (client->parser.error() == WebSocketFrameParser::Error::Protocol) {
+            std::cerr << "帧头违反协议，断开连接: " << client->clientId << std::endl;
+        } else {
+            ++budgetRejects;
+            std::cerr << "输入缓冲超出内存预算，断开连接: " << client->clientId << std::endl;
         }
-        
+        client->connected = false;
+    }
+    
+    // 处理WebSocket握手
+    bool handleHandshake(const std::shared_ptr<ClientConnection>& client, const std::string& request) {
+        std::string key = headerValue(request, "Sec-WebSocket-Key");
         if (key.empty()) {
             return false;
         }
@@ -419,14 +1081,58 @@ private:
         std::string response = "HTTP/1.1 101 Switching Protocols\r\n"
                                "Upgrade: websocket\r\n"
                                "Connection: Upgrade\r\n"
-                               "Sec-WebSocket-Accept: " + computeAcceptKey(key) + "\r\n\r\n";
+                               "Sec-WebSocket-Accept: " + computeAcceptKey(key) + "\r\n";
         
-        // 发送响应
-        if (send(clientSocket, response.c_str(), response.length(), 0) == SOCKET_ERROR_VALUE) {
-            return false;
+        // 协商permessage-deflate
+        std::string offers = headerValue(request, "Sec-WebSocket-Extensions");
+        if (!offers.empty()) {
+            DeflateOptions options;
+            {
+                std::lock_guard<std::mutex> lock(optionsMutex);
+                options = deflateOptions;
+            }
+            DeflateParams params;
+            std::string accepted;
+            if (negotiatePerMessageDeflate(offers, options, params, accepted)) {
+                std::unique_ptr<PerMessageDeflate> deflate(new PerMessageDeflate(params, options));
+                if (deflate->valid()) {
+                    client->deflate = std::move(deflate);
+                    response += "Sec-WebSocket-Extensions: " + accepted + "\r\n";
+                }
+            }
         }
+        response += "\r\n";
         
-        return true;
+        // 发送响应
+        return queueOutput(client, (const uint8_t*)response.data(), response.length());
+    }
+    
+    // 取HTTP请求头的值（名称不区分大小写），同名的多个请求头以逗号连接
+    static std::string headerValue(const std::string& request, const std::string& name) {
+        std::string value;
+        size_t lineStart = request.find("\r\n");
+        while (lineStart != std::string::npos) {
+            lineStart += 2;
+            size_t lineEnd = request.find("\r\n", lineStart);
+            if (lineEnd == std::string::npos || lineEnd == lineStart) {
+                break;
+            }
+            size_t colon = request.find(':', lineStart);
+            if (colon != std::string::npos && colon < lineEnd && colon - lineStart == name.size() &&
+                std::equal(name.begin(), name.end(), request.begin() + lineStart,
+                           [](char a, char b) { return tolower((unsigned char)a) == tolower((unsigned char)b); })) {
+                size_t begin = request.find_first_not_of(" \t", colon + 1);
+                size_t end = request.find_last_not_of(" \t", lineEnd - 1);
+                if (begin != std::string::npos && begin < lineEnd && end >= begin) {
+                    if (!value.empty()) {
+                        value += ", ";
+                    }
+                    value += request.substr(begin, end - begin + 1);
+                }
+            }
+            lineStart = lineEnd;
+        }
+        return value;
     }
     
     // 计算WebSocket握手的Accept Key
@@ -572,262 +1278,544 @@ private:
         return result;
     }
     
-    // 接收客户端数据的线程函数
-    void receiveLoop(std::shared_ptr<ClientConnection> client) {
-        // 设置socket为非阻塞模式，以便能够检测断开连接
-#ifdef _WIN32
-        u_long mode = 1;  // 非阻塞模式
-        ioctlsocket(client->socket, FIONBIO, &mode);
-#else
-        int flags = fcntl(client->socket, F_GETFL, 0);
-        fcntl(client->socket, F_SETFL, flags | O_NONBLOCK);
-#endif
-
-        while (client->connected && running) {
-            // 接收帧头
-            uint8_t frameHeader[2] = {0};
-            int recvResult = recv(client->socket, (char*)frameHeader, 2, 0);
-            
-            if (recvResult <= 0) {
-                // 检查是否是非阻塞模式下暂时没有数据
-                if (recvResult == SOCKET_ERROR_VALUE && SOCKET_LAST_ERROR == SOCKET_EWOULDBLOCK) {
-                    // 暂时没有数据，等待一会再试
-                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
-                    continue;
+    // 处理一个完整的帧：控制帧直接处理，数据帧按FIN位和CONTINUATION重组为消息
+    void handleFrame(const std::shared_ptr<ClientConnection>& client, WebSocketFrame& frame) {
+        // 负载是解析器给出的视图，只在本次调用期间有效
+        const uint8_t* payload = frame.payload;
+        size_t payloadLength = frame.payloadLength;
+        
+        switch (frame.opcode) {
+            case TEXT:
+            case BINARY: {
+                if (client->messageOpcode != CONTINUATION) {
+                    std::cerr << "上一条分片消息未结束又收到新消息，断开连接: " << client->clientId << std::endl;
+                    client->connected = false;
+                    return;
+                }
+                if (frame.fin) {
+                    handleMessage(client, frame.opcode, frame.compressed, payload, payloadLength);
+                    return;
                 }
                 
-                // 连接已断开
-                std::cout << "检测到客户端连接断开: " << client->clientId << std::endl;
-                break;
+                // 分片消息的第一片。未压缩的二进制消息在设置了分片回调时逐片交付，不在内存中重组
+                std::shared_ptr<const BinaryFragmentCallback> fragmentCallback = std::atomic_load(&binaryFragmentCallback);
+                client->messageOpcode = frame.opcode;
+                client->messageCompressed = frame.compressed;
+                client->messageStreaming = frame.opcode == BINARY && !frame.compressed && fragmentCallback && *fragmentCallback;
+                client->message.clear();
+                appendFragment(client, payload, payloadLength, true, false);
+                return;
             }
             
-            // 解析帧头
-            bool fin = (frameHeader[0] & 0x80) != 0;
-            OpCode opcode = (OpCode)(frameHeader[0] & 0x0F);
-            bool masked = (frameHeader[1] & 0x80) != 0;
-            uint64_t payloadLength = frameHeader[1] & 0x7F;
-            
-            // 读取扩展长度
-            if (payloadLength == 126) {
-                uint8_t lenBytes[2] = {0};
-                if (recv(client->socket, (char*)lenBytes, 2, 0) <= 0) {
-                    break;
-                }
-                payloadLength = (lenBytes[0] << 8) | lenBytes[1];
-            } else if (payloadLength == 127) {
-                uint8_t lenBytes[8] = {0};
-                if (recv(client->socket, (char*)lenBytes, 8, 0) <= 0) {
-                    break;
+            case CONTINUATION: {
+                if (client->messageOpcode == CONTINUATION || frame.compressed) {
+                    std::cerr << "无效的延续帧，断开连接: " << client->clientId << std::endl;
+                    client->connected = false;
+                    return;
                 }
-                payloadLength = 0;
-                for (int i = 0; i < 8; ++i) {
-                    payloadLength = (payloadLength << 8) | lenBytes[i];
+                appendFragment(client, payload, payloadLength, false, frame.fin);
+                if (frame.fin && client->connected) {
+                    OpCode opcode = client->messageOpcode;
+                    client->messageOpcode = CONTINUATION;
+                    if (!client->messageStreaming) {
+                        handleMessage(client, opcode, client->messageCompressed, client->message.data(), client->message.size());
+                    }
+                    releaseMessage(client);
                 }
+                return;
             }
             
-            // 读取掩码（如果有）
-            uint8_t mask[4] = {0};
-            if (masked) {
-                if (recv(client->socket, (char*)mask, 4, 0) <= 0) {
-                    break;
-                }
+            default:
+                break;
+        }
+        
+        // 控制帧不能分片，可以夹在分片消息的各片之间
+        if (!frame.fin || payloadLength > 125) {
+            std::cerr << "无效的控制帧，断开连接: " << client->clientId << std::endl;
+            client->connected = false;
+            return;
+        }
+        
+        switch (frame.opcode) {
+            case PING: {
+                // 响应PING
+                sendFrame(client, PONG, payload, payloadLength);
+                break;
             }
             
-            // 读取负载数据
-            std::vector<uint8_t> payload(payloadLength);
-            size_t bytesRemaining = payloadLength;
-            size_t offset = 0;
+            case PONG:
+                break;
             
-            while (bytesRemaining > 0) {
-                int bytesRead = recv(client->socket, (char*)payload.data() + offset, bytesRemaining, 0);
-                if (bytesRead <= 0) {
-                    break;
-                }
-                bytesRemaining -= bytesRead;
-                offset += bytesRead;
+            case CLOSE: {
+                // 收到关闭帧，回应后断开连接
+                sendFrame(client, CLOSE, payload, std::min<size_t>(payloadLength, 2));
+                client->connected = false;
+                break;
             }
             
-            // 解除掩码（如果有）
-            if (masked) {
-                for (size_t i = 0; i < payloadLength; ++i) {
-                    payload[i] ^= mask[i % 4];
-                }
+            default:
+                std::cout << "未知..." << std::endl;
+                break;
+        }
+    }
+    
+    // 处理分片消息的一片：逐片交付或追加到重组缓冲区
+    void appendFragment(const std::shared_ptr<ClientConnection>& client, const uint8_t* data, size_t length, bool first, bool last) {
+        if (client->messageStreaming) {
+            std::shared_ptr<const BinaryFragmentCallback> callback = std::atomic_load(&binaryFragmentCallback);
+            if (callback && *callback) {
+                (*callback)(data, length, first, last, client->clientId, client->context.get());
+            }
+            return;
+        }
+        if (client->message.size() + length > client->maxMessageBytes) {
+            ++oversizedMessages;
+            std::cerr << "分片消息超过长度上限，断开连接: " << client->clientId << std::endl;
+            client->connected = false;
+            return;
+        }
+        if (client->budget) {
+            if (!client->budget->tryReserve(length)) {
+                ++budgetRejects;
+                std::cerr << "输入缓冲超出内存预算，断开连接: " << client->clientId << std::endl;
+                client->connected = false;
+                return;
+            }
+            client->messageReserved += length;
+        }
+        client->message.insert(client->message.end(), data, data + length);
+    }
+    
+    // 清空重组缓冲区并归还预留的内存
+    void releaseMessage(const std::shared_ptr<ClientConnection>& client) {
+        if (client->messageReserved > 0) {
+            client->budget->release(client->messageReserved);
+            client->messageReserved = 0;
+        }
+        client->message.clear();
+        if (client->message.capacity() > WebSocketFrameParser::MAX_RETAINED_BUFFER) {
+            std::vector<uint8_t>().swap(client->message);
+        }
+    }
+    
+    // 处理一条完整的消息（单帧或重组后的分片消息）
+    void handleMessage(const std::shared_ptr<ClientConnection>& client, OpCode opcode, bool compressed, const uint8_t* data, size_t length) {
+        // 压缩的消息先解压
+        if (compressed) {
+            if (!client->deflate ||
+                !client->deflate->decompress(data, length, client->inflated, client->maxMessageBytes)) {
+                std::cerr << "解压消息失败，断开连接: " << client->clientId << std::endl;
+                client->connected = false;
+                return;
+            }
+            data = client->inflated.data();
+            length = client->inflated.size();
+        }
+        
+        if (opcode == TEXT) {
+            std::string message((const char*)data, length);
+            
+            // 调用回调
+            std::shared_ptr<const ReceiveCallback> callback = std::atomic_load(&receiveCallback);
+            if (callback && *callback) {
+                (*callback)(message, client->clientId, client->context.get());
+            }
+        } else {
+            // 音频数据直接以原始字节交给上层，不经过字符串和JSON
+            std::shared_ptr<const BinaryCallback> callback = std::atomic_load(&binaryCallback);
+            if (callback && *callback) {
+                (*callback)(data, length, client->clientId, client->context.get());
+            }
+        }
+    }
+    
+    // 把编码好的帧交给目标客户端（空表示所有客户端）
+    // 定向发送按ID查找，广播遍历连接表快照，都不持有全局锁，慢客户端不会拖住其他连接
+    bool deliverFrame(const SharedFrame& frame, const std::string& targetClientId, MessageClass messageClass) {
+        OutboundQueueOptions options;
+        {
+            std::lock_guard<std::mutex> lock(optionsMutex);
+            options = queueOptions;
+        }
+        
+        if (!targetClientId.empty()) {
+            std::shared_ptr<ClientConnection> client = connections.findById(targetClientId);
+            if (!client || !client->connected) {
+                // 未找到指定客户端
+                return false;
+            }
+            return enqueueFrame(client, frame, messageClass, options);
+        }
+        
+        // 发送失败的连接由所属I/O线程关闭并移出连接表
+        bool success = true;
+        std::shared_ptr<const ConnectionTable::ConnectionList> targets = connections.snapshot();
+        for (auto& client : *targets) {
+            if (!client->connected || !enqueueFrame(client, frame, messageClass, options)) {
+                success = false;
+            }
+        }
+        return success;
+    }
+    
+    // 把帧加入连接的发送队列，由所属I/O线程发送；队列超出上限时按慢客户端策略处理
+    bool enqueueFrame(const std::shared_ptr<ClientConnection>& client, const SharedFrame& frame,
+                      MessageClass messageClass, const OutboundQueueOptions& options) {
+        bool wasEmpty;
+        {
+            std::lock_guard<std::mutex> lock(client->writeMutex);
+            if (client->socket == INVALID_SOCKET_VALUE) {
+                return false;
             }
             
-            // 处理帧
-            switch (opcode) {
-                case TEXT: {
-                    std::string message((char*)payload.data(), payload.size());
-                    
-                    // 调用回调
-                    std::lock_guard<std::mutex> lock(callbackMutex);
-                    if (receiveCallback) {
-                        receiveCallback(message, client->clientId);
+            // 新的实时结果取代还没发出的旧结果
+            if (messageClass == MessageClass::Partial && options.policy == SlowClientPolicy::Coalesce) {
+                coalescedPartials += removeUnsentPartials(client);
+            }
+            
+            auto overLimit = [&]() {
+                return client->outQueue.size() + 1 > options.maxFrames ||
+                       client->queuedBytes + frame->size() > options.maxBytes;
+            };
+            if (overLimit()) {
+                if (options.policy != SlowClientPolicy::Disconnect) {
+                    droppedPartials += removeUnsentPartials(client);
+                }
+                if (overLimit()) {
+                    if (messageClass == MessageClass::Partial && options.policy != SlowClientPolicy::Disconnect) {
+                        ++droppedPartials;
+                        return true;
                     }
+                    // 最终结果不能丢弃，断开跟不上的客户端
+                    std::cerr << "客户端接收过慢，发送队列积压 " << client->outQueue.size() << " 帧 / "
+                              << client->queuedBytes / 1024 << " KB，断开连接: " << client->clientId << std::endl;
+                    ++slowDisconnects;
+                    client->outQueue.clear();
+                    client->outOffset = 0;
+                    client->queuedBytes = 0;
+                    client->connected = false;
+                    SHUTDOWN_SOCKET(client->socket);
+                    return false;
+                }
+            }
+            
+            wasEmpty = client->outQueue.empty();
+            client->outQueue.push_back({frame, messageClass, true, false});
+            client->queuedBytes += frame->size();
+            client->pendingOutput = true;
+        }
+        
+        // 队列由空变为非空时通知所属I/O线程发送，之后的数据由I/O线程在可写时继续发送
+        if (wasEmpty) {
+            std::shared_ptr<IoThread> io = client->io;
+            {
+                std::lock_guard<std::mutex> lock(io->pendingMutex);
+                io->flushRequests.push_back(client->handle);
+            }
+            io->poller.wakeup();
+        }
+        return true;
+    }
+    
+    // 移除队列中尚未开始发送的实时结果，返回移除的数量；调用时需持有writeMutex
+    size_t removeUnsentPartials(const std::shared_ptr<ClientConnection>& client) {
+        auto& queue = client->outQueue;
+        // 已发送一部分的队首帧必须发完
+        auto begin = queue.begin();
+        if (begin != queue.end() && client->outOffset > 0) {
+            ++begin;
+        }
+        size_t removed = 0;
+        auto it = std::remove_if(begin, queue.end(), [&](const QueuedFrame& queued) {
+            if (queued.messageClass != MessageClass::Partial || queued.compressed) {
+                return false;
+            }
+            client->queuedBytes -= queued.frame->size();
+            ++removed;
+            return true;
+        });
+        queue.erase(it, queue.end());
+        return removed;
+    }
+    
+    // 发送WebSocket帧：帧头在栈上构造，负载不复制，与帧头一起分散写出
+    bool sendFrame(const std::shared_ptr<ClientConnection>& client, OpCode opcode, const uint8_t* payload, size_t length) {
+        uint8_t header[MAX_FRAME_HEADER_SIZE];
+        OutputSlice slices[2] = {
+            {header, encodeFrameHeader(header, true, opcode, length)},
+            {payload, payload ? length : 0}
+        };
+        return queueOutput(client, slices, 2);
+    }
+    
+    // 发送一段连续数据
+    bool queueOutput(const std::shared_ptr<ClientConnection>& client, const uint8_t* data, size_t length) {
+        OutputSlice slice = {data, length};
+        return queueOutput(client, &slice, 1);
+    }
+    
+    // 发送数据：没有积压时直接写socket，写不完的部分复制到积压缓冲区，留给I/O线程在可写时继续发送
+    bool queueOutput(const std::shared_ptr<ClientConnection>& client, OutputSlice* slices, size_t count) {
+        std::lock_guard<std::mutex> lock(client->writeMutex);
+        if (client->socket == INVALID_SOCKET_VALUE) {
+            return false;
+        }
+        
+        size_t first = 0;  // 第一个未发完的段
+        if (client->outQueue.empty()) {
+            while (true) {
+                while (first < count && slices[first].length == 0) {
+                    ++first;
+                }
+                if (first == count) {
                     break;
                 }
                 
-                case BINARY: {
-                    // 将二进制数据转换为float数组
-                    std::vector<float> audio_data(payloadLength / sizeof(float));
-                    memcpy(audio_data.data(), payload.data(), payloadLength);
-                    
-                    // 进行声纹识别
-                    std::string speaker = VoiceprintRecognition::getInstance().processAudio(audio_data, 16000.0f);
-                    
-                    // 更新客户端说话人信息
-                    if (speaker != "unknown" && speaker != client->current_speaker) {
-                        client->current_speaker = speaker;
-                        
-                        // 发送说话人信息给客户端
-                        std::string speaker_info = "{\"type\":\"speaker\",\"speaker\":\"" + speaker + "\"}";
-                        sendFrame(client->socket, TEXT, (const uint8_t*)speaker_info.c_str(), speaker_info.length());
+                long result = sendSlices(client->socket, slices + first, count - first);
+                if (result > 0) {
+                    // 短写：跳过已发送的段，从中断处继续
+                    size_t sent = (size_t)result;
+                    while (first < count && sent >= slices[first].length) {
+                        sent -= slices[first].length;
+                        ++first;
                     }
-                    
-                    // 继续处理音频数据
-                    // 将二进制数据转换为字符串
-                    std::string message((char*)payload.data(), payload.size());
-                    
-                    // 调用回调
-                    std::lock_guard<std::mutex> lock(callbackMutex);
-                    if (receiveCallback) {
-                        receiveCallback(message, client->clientId);
+                    if (first < count) {
+                        slices[first].data += sent;
+                        slices[first].length -= sent;
                     }
-                    break;
+                    continue;
                 }
-                
-                case PING: {
-                    // 响应PING
-                    sendFrame(client->socket, PONG, payload.data(), payload.size());
+                int error = SOCKET_LAST_ERROR;
+                if (wouldBlock(error)) {
                     break;
                 }
-                
-                case CLOSE: {
-                    // 收到关闭帧，断开连接
+                if (error != SOCKET_EINTR) {
+                    // 让所属I/O线程感知错误并关闭连接
                     client->connected = false;
-                    // std::cout << "客户端断开连接: " << client->clientId << "，当前连接数: " << clients.size() << std::endl;
-                    
-                    // 关闭socket
-                    if (client->socket != INVALID_SOCKET_VALUE) {
-                        CLOSE_SOCKET(client->socket);
-                        client->socket = INVALID_SOCKET_VALUE;
-                    }
-                    break;
+                    SHUTDOWN_SOCKET(client->socket);
+                    return false;
                 }
-                
-                default:
-                    std::cout << "未知..." << std::endl;
-                    break;
             }
         }
         
-        client->connected = false;
-        
-        // 处理客户端断开连接的情况
-        std::cout << "客户端已断开连接: " << client->clientId << std::endl;
-        
-        // 不直接从列表中移除，而是标记为断开状态
-        {
-            std::lock_guard<std::mutex> lock(disconnectedClientsMutex);
-            disconnectedClients.push_back(client);
+        if (first < count) {
+            // 只复制没发出去的部分
+            size_t remaining = 0;
+            for (size_t i = first; i < count; ++i) {
+                remaining += slices[i].length;
+            }
+            auto rest = std::make_shared<std::vector<uint8_t>>();
+            rest->reserve(remaining);
+            for (size_t i = first; i < count; ++i) {
+                rest->insert(rest->end(), slices[i].data, slices[i].data + slices[i].length);
+            }
+            client->queuedBytes += rest->size();
+            client->outQueue.push_back({std::move(rest), MessageClass::Reliable, false, false});
+            client->pendingOutput = true;
+        }
+        return true;
+    }
+    
+    // socket可写时继续发送积压数据
+    void flushOutput(const std::shared_ptr<ClientConnection>& client) {
+        std::lock_guard<std::mutex> lock(client->writeMutex);
+        if (client->socket == INVALID_SOCKET_VALUE) {
+            return;
         }
+        sendQueuedLocked(client);
     }
     
-    // 发送WebSocket帧
-    bool sendFrame(socket_t socket, OpCode opcode, const uint8_t* payload, size_t length) {
-        // 构造WebSocket帧头
-        std::vector<uint8_t> frame;
-        frame.push_back(0x80 | opcode); // FIN + opcode
-        
-        // 添加Payload长度
-        if (length < 126) {
-            frame.push_back(length);
-        } else if (length < 65536) {
-            frame.push_back(126);
-            frame.push_back((length >> 8) & 0xFF);
-            frame.push_back(length & 0xFF);
-        } else {
-            frame.push_back(127);
-            frame.push_back(0); // 假设长度不超过32位
-            frame.push_back(0);
-            frame.push_back(0);
-            frame.push_back(0);
-            frame.push_back((length >> 24) & 0xFF);
-            frame.push_back((length >> 16) & 0xFF);
-            frame.push_back((length >> 8) & 0xFF);
-            frame.push_back(length & 0xFF);
+    // 发送前按协商的permessage-deflate压缩数据帧；调用时需持有writeMutex
+    // 在发送时而不是入队时压缩，被丢弃或合并的实时结果不会进入压缩上下文
+    void compressQueuedLocked(const std::shared_ptr<ClientConnection>& client, QueuedFrame& queued) {
+        queued.compressible = false;
+        const std::vector<uint8_t>& frame = *queued.frame;
+        size_t headerSize = frameHeaderSize(frame.data());
+        size_t length = frame.size() - headerSize;
+        if (!client->deflate->shouldCompress(length)) {
+            return;
         }
         
-        // 添加Payload
-        if (payload && length > 0) {
-            frame.insert(frame.end(), payload, payload + length);
+        // 先在前面预留最长的帧头，压缩后按实际长度写帧头并前移负载
+        auto compressed = std::make_shared<std::vector<uint8_t>>(MAX_FRAME_HEADER_SIZE);
+        compressed->reserve(MAX_FRAME_HEADER_SIZE + length / 2 + 64);
+        if (!client->deflate->compress(frame.data() + headerSize, length, *compressed)) {
+            return;
         }
+        size_t compressedLength = compressed->size() - MAX_FRAME_HEADER_SIZE;
+        uint8_t header[MAX_FRAME_HEADER_SIZE];
+        size_t compressedHeaderSize = encodeFrameHeader(header, true, (OpCode)(frame[0] & 0x0F), compressedLength, true);
+        memmove(compressed->data() + compressedHeaderSize, compressed->data() + MAX_FRAME_HEADER_SIZE, compressedLength);
+        memcpy(compressed->data(), header, compressedHeaderSize);
+        compressed->resize(compressedHeaderSize + compressedLength);
         
-        // 发送帧
-        int result = send(socket, (const char*)frame.data(), frame.size(), 0);
-        return result != SOCKET_ERROR_VALUE;
+        client->queuedBytes = client->queuedBytes - frame.size() + compressed->size();
+        queued.frame = std::move(compressed);
+        queued.compressed = true;
     }
     
-    // 周期性清理已断开连接的客户端
-    void cleanupLoop() {
-        while (cleanupThreadRunning) {
-            // 每隔一段时间清理一次断开的客户端
-            std::this_thread::sleep_for(std::chrono::seconds(5));
+    // 把发送队列中的帧分散写出，直到队列清空或socket写满；调用时需持有writeMutex
+    bool sendQueuedLocked(const std::shared_ptr<ClientConnection>& client) {
+        auto& queue = client->outQueue;
+        while (!queue.empty()) {
+            OutputSlice slices[MAX_OUTPUT_SLICES];
+            size_t count = 0;
+            for (auto it = queue.begin(); it != queue.end() && count < MAX_OUTPUT_SLICES; ++it, ++count) {
+                size_t offset = count == 0 ? client->outOffset : 0;
+                if (offset == 0 && it->compressible && client->deflate) {
+                    compressQueuedLocked(client, *it);
+                }
+                slices[count].data = it->frame->data() + offset;
+                slices[count].length = it->frame->size() - offset;
+            }
             
-            cleanupDisconnectedClients();
+            long result = sendSlices(client->socket, slices, count);
+            if (result > 0) {
+                // 弹出已发完的帧，短写时记录队首帧的发送位置
+                size_t sent = (size_t)result;
+                while (!queue.empty() && sent >= queue.front().frame->size() - client->outOffset) {
+                    sent -= queue.front().frame->size() - client->outOffset;
+                    client->queuedBytes -= queue.front().frame->size();
+                    client->outOffset = 0;
+                    queue.pop_front();
+                }
+                client->outOffset += sent;
+                continue;
+            }
+            int error = SOCKET_LAST_ERROR;
+            if (wouldBlock(error)) {
+                client->pendingOutput = true;
+                return true;
+            }
+            if (error != SOCKET_EINTR) {
+                // 让所属I/O线程感知错误并关闭连接
+                client->connected = false;
+                SHUTDOWN_SOCKET(client->socket);
+                return false;
+            }
         }
+        
+        client->outOffset = 0;
+        client->queuedBytes = 0;
+        client->pendingOutput = false;
+        return true;
     }
     
-    // 清理已断开连接的客户端
-    void cleanupDisconnectedClients() {
-        std::vector<std::shared_ptr<ClientConnection>> clientsToRemove;
-        
-        // 先获取需要删除的客户端列表
+    // 关闭连接（只在所属I/O线程调用）
+    void closeConnection(IoThread* io, const std::shared_ptr<ClientConnection>& client) {
+        std::shared_ptr<ClientConnection> keep = client;
+        io->poller.remove(client->socket);
         {
-            std::lock_guard<std::mutex> lock(disconnectedClientsMutex);
-            if (disconnectedClients.empty()) {
-                return;
+            std::lock_guard<std::mutex> lock(client->writeMutex);
+            if (client->socket != INVALID_SOCKET_VALUE) {
+                CLOSE_SOCKET(client->socket);
+                client->socket = INVALID_SOCKET_VALUE;
             }
-            
-            clientsToRemove.swap(disconnectedClients);
         }
+        client->connected = false;
+        io->connections.erase(client->handle);
+        releaseMessage(client);
+        client->parser.reset();
         
-        // 然后从客户端列表中移除
-        {
-            std::lock_guard<std::mutex> lock(clientsMutex);
-            for (auto& clientToRemove : clientsToRemove) {
-                // 关闭socket
-                if (clientToRemove->socket != INVALID_SOCKET_VALUE) {
-                    CLOSE_SOCKET(clientToRemove->socket);
-                    clientToRemove->socket = INVALID_SOCKET_VALUE;
-                }
-                
-                // 从列表中删除
-                auto it = std::find_if(clients.begin(), clients.end(), 
-                    [&clientToRemove](const std::shared_ptr<ClientConnection>& c) {
-                        return c->clientId == clientToRemove->clientId;
-                    });
-                
-                if (it != clients.end()) {
-                    std::cout << "清理已断开的客户端: " << (*it)->clientId << std::endl;
-                    clients.erase(it);
-                    std::cout << "当前连接数: " << clients.size() << std::endl;
-                }
+        // 处理客户端断开连接的情况
+        std::cout << "客户端已断开连接: " << client->clientId << std::endl;
+        
+        if (client->handshakeDone && connections.remove(client)) {
+            std::cout << "当前连接数: " << connections.size() << std::endl;
+            
+            // 连接上的消息都已交给上层，之后不会再有该客户端的回调
+            std::shared_ptr<const DisconnectCallback> callback = std::atomic_load(&disconnectCallback);
+            if (callback && *callback) {
+                (*callback)(client->clientId, client->context.get());
             }
         }
+        client->context.reset();
+    }
+    
+    // 启动失败时关闭监听socket
+    void closeServerSocket() {
+        CLOSE_SOCKET(serverSocket);
+        serverSocket = INVALID_SOCKET_VALUE;
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+    
+    // 周期性输出发送队列统计
+    void monitorLoop() {
+        std::unique_lock<std::mutex> lock(monitorMutex);
+        while (monitorThreadRunning) {
+            monitorCondition.wait_for(lock, std::chrono::seconds(5));
+            
+            lock.unlock();
+            logOutboundQueueStats();
+            logInputLimitStats();
+            lock.lock();
+        }
+    }
+    
+    // 有积压或发生丢弃、断开时输出发送队列统计
+    void logOutboundQueueStats() {
+        OutboundQueueStats stats = outboundQueueStats();
+        if (stats.queuedFrames == 0 && stats.droppedPartials == loggedDroppedPartials &&
+            stats.coalescedPartials == loggedCoalescedPartials && stats.slowDisconnects == loggedSlowDisconnects) {
+            return;
+        }
+        std::cout << "发送队列: 连接 " << stats.connections
+                  << "，排队 " << stats.queuedFrames << " 帧 / " << stats.queuedBytes / 1024 << " KB"
+                  << "，单连接最大积压 " << stats.maxQueuedBytes / 1024 << " KB"
+                  << "，累计丢弃实时结果 " << stats.droppedPartials
+                  << "，合并 " << stats.coalescedPartials
+                  << "，因积压断开 " << stats.slowDisconnects << std::endl;
+        loggedDroppedPartials = stats.droppedPartials;
+        loggedCoalescedPartials = stats.coalescedPartials;
+        loggedSlowDisconnects = stats.slowDisconnects;
+    }
+    
+    // 有帧或消息因超出限制被拒绝时输出统计
+    void logInputLimitStats() {
+        InputLimitStats stats = inputLimitStats();
+        uint64_t rejects = stats.oversizedFrames + stats.oversizedMessages + stats.budgetRejects;
+        if (rejects == loggedInputRejects) {
+            return;
+        }
+        std::cout << "输入限制: 累计拒绝超长帧 " << stats.oversizedFrames
+                  << "，超长消息 " << stats.oversizedMessages
+                  << "，超出内存预算 " << stats.budgetRejects
+                  << "，当前预留 " << stats.budgetUsed / 1024 << " KB" << std::endl;
+        loggedInputRejects = rejects;
     }
     
     socket_t serverSocket;
     std::atomic<bool> running;
-    std::thread* acceptThread;
-    std::thread* cleanupThread;
-    std::atomic<bool> cleanupThreadRunning;
-    std::vector<std::shared_ptr<ClientConnection>> clients;
-    std::mutex clientsMutex;
-    std::vector<std::shared_ptr<ClientConnection>> disconnectedClients;
-    std::mutex disconnectedClientsMutex;
-    std::function<void(const std::string&, const std::string&)> receiveCallback;
-    std::mutex callbackMutex;
+    std::vector<std::shared_ptr<IoThread>> ioThreads;  // 连接也持有所属线程，停止后仍可安全入队
+    size_t nextIoThread;                 // 只由监听所在的I/O线程访问
+    std::atomic<uint64_t> nextHandle;
+    std::thread* monitorThread;
+    std::atomic<bool> monitorThreadRunning;
+    std::mutex monitorMutex;
+    std::condition_variable monitorCondition;
+    ConnectionTable connections;
+    OutboundQueueOptions queueOptions;
+    DeflateOptions deflateOptions;
+    InputLimits inputLimits;
+    std::shared_ptr<MemoryBudget> memoryBudget;  // 为空表示不限制总内存
+    std::mutex optionsMutex;
+    std::atomic<uint64_t> droppedPartials{0};
+    std::atomic<uint64_t> coalescedPartials{0};
+    std::atomic<uint64_t> slowDisconnects{0};
+    std::atomic<uint64_t> oversizedFrames{0};
+    std::atomic<uint64_t> oversizedMessages{0};
+    std::atomic<uint64_t> budgetRejects{0};
+    uint64_t loggedDroppedPartials = 0;      // 以下只由统计线程访问
+    uint64_t loggedCoalescedPartials = 0;
+    uint64_t loggedSlowDisconnects = 0;
+    uint64_t loggedInputRejects = 0;
+    std::shared_ptr<const ConnectCallback> connectCallback;  // 以原子方式替换，I/O线程调用时无需加锁
+    std::shared_ptr<const ReceiveCallback> receiveCallback;
+    std::shared_ptr<const BinaryCallback> binaryCallback;
+    std::shared_ptr<const BinaryFragmentCallback> binaryFragmentCallback;
+    std::shared_ptr<const DisconnectCallback> disconnectCallback;
 };
 
 // WebSocketServer实现
@@ -837,8 +1825,8 @@ WebSocketServer::~WebSocketServer() {
     stop();
 }
 
-bool WebSocketServer::start(int port) {
-    bool result = impl_->start(port);
+bool WebSocketServer::start(int port, int ioThreads) {
+    bool result = impl_->start(port, ioThreads);
     running_ = result;
     return result;
 }
@@ -850,11 +1838,11 @@ void WebSocketServer::stop() {
     running_ = false;
 }
 
-bool WebSocketServer::broadcastText(const std::string& message, const std::string& targetClientId) {
+bool WebSocketServer::broadcastText(const std::string& message, const std::string& targetClientId, MessageClass messageClass) {
     if (!impl_ || !running_) {
         return false;
     }
-    return impl_->broadcastText(message, targetClientId);
+    return impl_->broadcastText(message, targetClientId, messageClass);
 }
 
 bool WebSocketServer::broadcastBinary(const std::vector<float>& data, const std::string& targetClientId) {
@@ -864,20 +1852,72 @@ bool WebSocketServer::broadcastBinary(const std::vector<float>& data, const std:
     return impl_->broadcastBinary(data, targetClientId);
 }
 
-void WebSocketServer::setReceiveCallback(std::function<void(const std::string&, const std::string&)> callback) {
+void WebSocketServer::setConnectCallback(std::function<std::shared_ptr<void>(const std::string&)> callback) {
+    if (impl_) {
+        impl_->setConnectCallback(callback);
+    }
+}
+
+void WebSocketServer::setReceiveCallback(std::function<void(const std::string&, const std::string&, void*)> callback) {
     std::lock_guard<std::mutex> lock(callbackMutex_);
     receiveCallback_ = callback;
     
+    // 回调直接交给I/O线程调用，多个I/O线程之间不再串行
     if (impl_) {
-        impl_->setReceiveCallback([this](const std::string& message, const std::string& clientId) {
-            std::lock_guard<std::mutex> lock(callbackMutex_);
-            if (receiveCallback_) {
-                receiveCallback_(message, clientId);
-            }
-        });
+        impl_->setReceiveCallback(callback);
+    }
+}
+
+void WebSocketServer::setBinaryCallback(std::function<void(const uint8_t*, size_t, const std::string&, void*)> callback) {
+    if (impl_) {
+        impl_->setBinaryCallback(callback);
+    }
+}
+
+void WebSocketServer::setDisconnectCallback(std::function<void(const std::string&, void*)> callback) {
+    if (impl_) {
+        impl_->setDisconnectCallback(callback);
+    }
+}
+
+void WebSocketServer::setBinaryFragmentCallback(std::function<void(const uint8_t*, size_t, bool, bool, const std::string&, void*)> callback) {
+    if (impl_) {
+        impl_->setBinaryFragmentCallback(callback);
+    }
+}
+
+void WebSocketServer::setOutboundQueueOptions(const OutboundQueueOptions& options) {
+    if (impl_) {
+        impl_->setOutboundQueueOptions(options);
+    }
+}
+
+void WebSocketServer::setCompressionOptions(const DeflateOptions& options) {
+    if (impl_) {
+        impl_->setCompressionOptions(options);
+    }
+}
+
+void WebSocketServer::setInputLimits(const InputLimits& limits, std::shared_ptr<MemoryBudget> budget) {
+    if (impl_) {
+        impl_->setInputLimits(limits, std::move(budget));
+    }
+}
+
+InputLimitStats WebSocketServer::inputLimitStats() const {
+    if (!impl_) {
+        return InputLimitStats();
     }
+    return impl_->inputLimitStats();
+}
+
+OutboundQueueStats WebSocketServer::outboundQueueStats() const {
+    if (!impl_) {
+        return OutboundQueueStats();
+    }
+    return impl_->outboundQueueStats();
 }
 
 bool WebSocketServer::isRunning() const {
     return running_ && impl_ && impl_->isRunning();
-} 
\ No newline at end of file
+}